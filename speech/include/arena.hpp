@@ -0,0 +1,74 @@
+/*
+ * @file arena.hpp
+ * @brief bump allocator for the buffers of one analysis
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * @brief Arena class
+ * @detail hands out aligned buffers by bumping an offset, nothing is freed
+ * until reset(). reset() keeps the memory, when an analysis needed more than
+ * one block they are merged into a single block of the combined size, so
+ * once the biggest input has been seen the following analyses allocate
+ * nothing.
+ */
+class Arena {
+ public:
+  //! cache line, also enough for any simd load
+  static const std::size_t kAlign = 64;
+
+  Arena() = default;
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /*
+   * @return count uninitialized T, valid until reset()
+   * @throw std::bad_alloc when the arena cannot grow
+   */
+  template <typename T>
+  T *take(std::size_t count) {
+    return static_cast<T *>(allocate(count * sizeof(T)));
+  }
+
+  void *allocate(std::size_t bytes);
+
+  /*
+   * @brief forget every buffer handed out, the memory is kept
+   */
+  void reset();
+
+  //! bytes handed out since the last reset
+  std::size_t used() const { return usedBytes; }
+  //! most bytes ever handed out between two resets
+  std::size_t peak() const { return peakBytes; }
+  //! bytes held
+  std::size_t capacity() const;
+
+ private:
+  struct Block {
+    void *raw;
+    char *data;
+    std::size_t size;
+  };
+
+  void addBlock(std::size_t size);
+
+  std::vector<Block> blocks;
+  std::size_t current{};
+  std::size_t offset{};
+  std::size_t usedBytes{};
+  std::size_t peakBytes{};
+};
+
+#endif  // ARENA_HPP
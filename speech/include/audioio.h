@@ -1,54 +1,200 @@
-//-----------------------------------------------------------------------------
-// Copyright 2012 Masanori Morise
-// Author: mmorise [at] meiji.ac.jp (Masanori Morise)
-// Last update: 2021/02/15
-//-----------------------------------------------------------------------------
-
-#ifndef WORLD_AUDIOIO_H_
-#define WORLD_AUDIOIO_H_
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-//-----------------------------------------------------------------------------
-// wavwrite() write a .wav file.
-// Input:
-//   x          : Input signal
-//   x_ength : Signal length of x [sample]
-//   fs         : Sampling frequency [Hz]
-//   nbit       : Quantization bit [bit]
-//   filename   : Name of the output signal.
-// Caution:
-//   The variable nbit is not used in this function.
-//   This function only supports the 16 bit.
-//-----------------------------------------------------------------------------
-void wavwrite(const double *x, int x_length, int fs, int nbit,
-              const char *filename);
-
-//-----------------------------------------------------------------------------
-// GetAudioLength() returns the length of .wav file.
-// Input:
-//   filename     : Filename of a .wav file.
-// Output:
-//   The number of samples of the file .wav
-//-----------------------------------------------------------------------------
-int GetAudioLength(const char *filename);
-
-//-----------------------------------------------------------------------------
-// wavread() read a .wav file.
-// The memory of output x must be allocated in advance.
-// Input:
-//   filename     : Filename of the input file.
-// Output:
-//   fs           : Sampling frequency [Hz]
-//   nbit         : Quantization bit [bit]
-//   x            : The output waveform.
-//-----------------------------------------------------------------------------
-void wavread(const char *filename, int *fs, int *nbit, double *x);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif  // WORLD_AUDIOIO_H_
+//-----------------------------------------------------------------------------
+// Copyright 2012 Masanori Morise
+// Author: mmorise [at] meiji.ac.jp (Masanori Morise)
+// Last update: 2021/02/15
+//-----------------------------------------------------------------------------
+
+#ifndef WORLD_AUDIOIO_H_
+#define WORLD_AUDIOIO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// WavFile holds a read-only mapping of a .wav file and the parameters parsed
+// from its header. The PCM payload is not copied; data points into the
+// mapping until wavclose() is called.
+//   fs     : Sampling frequency [Hz]
+//   nbit   : Quantization bit [bit]
+//   format : Format ID, 1 for integer PCM, 3 for IEEE float, 6 for G.711
+//            A-law and 7 for G.711 mu-law
+//   channels : The number of interleaved channels, 0 is taken as 1
+//   length : The number of samples per channel in the data chunk, 64 bit so
+//            that RF64 files of more than 2^31 samples are described
+//   data   : First byte of the data chunk payload
+//   base   : Start of the mapping (internal)
+//   size   : Size of the mapping in bytes (internal)
+//-----------------------------------------------------------------------------
+typedef struct {
+  int fs;
+  int nbit;
+  int format;
+  int channels;
+  int64_t length;
+  const unsigned char *data;
+  const void *base;
+  size_t size;
+} WavFile;
+
+//-----------------------------------------------------------------------------
+// wavopen() maps a .wav file into memory and parses its header once. RIFF,
+// RF64 and BW64 files holding integer PCM or IEEE float, plain or as
+// WAVE_FORMAT_EXTENSIBLE, are supported.
+// Input:
+//   filename     : Filename of the input file.
+// Output:
+//   wav          : Header parameters and the mapped payload.
+//   1 on success, 0 if the file cannot be opened and -1 if the file is not
+//   a supported .wav file. wav is left closed unless 1 is returned.
+//-----------------------------------------------------------------------------
+int wavopen(const char *filename, WavFile *wav);
+
+//-----------------------------------------------------------------------------
+// wavparse() parses a .wav file that is already in memory. Nothing is mapped
+// or copied, data points into bytes which must outlive wav. wavclose() is not
+// needed but harmless.
+// Input:
+//   bytes        : The whole RIFF file.
+//   size         : Size of bytes in bytes.
+// Output:
+//   wav          : Header parameters and the payload.
+//   1 on success and -1 if bytes is not a supported .wav file.
+//-----------------------------------------------------------------------------
+int wavparse(const void *bytes, size_t size, WavFile *wav);
+
+//-----------------------------------------------------------------------------
+// wavdecode() converts the whole PCM payload of an opened file to double in
+// a single pass. The memory of output x must hold wav->length samples.
+// Input:
+//   wav          : File opened by wavopen().
+// Output:
+//   x            : The output waveform.
+//-----------------------------------------------------------------------------
+void wavdecode(const WavFile *wav, double *x);
+
+//-----------------------------------------------------------------------------
+// wavdecoderange() converts samples [start, start + count) of an opened file.
+// Only the pages holding that range are touched, so long files can be
+// decoded block by block with memory bounded by the block size. Only the
+// first channel of a multichannel file is decoded.
+// Input:
+//   wav          : File opened by wavopen().
+//   start        : First sample
+//   count        : The number of samples
+// Output:
+//   x            : The output waveform, count samples.
+//-----------------------------------------------------------------------------
+void wavdecoderange(const WavFile *wav, int64_t start, int count,
+                    double *x);
+
+//-----------------------------------------------------------------------------
+// wavdecodechannel() converts samples [start, start + count) of one channel,
+// like wavdecoderange() does for the first one. Only that channel is
+// converted, the bytes of the others are skipped.
+// Input:
+//   wav          : File opened by wavopen().
+//   channel      : Channel in [0, wav->channels)
+//   start        : First sample
+//   count        : The number of samples
+// Output:
+//   x            : The output waveform, count samples.
+//-----------------------------------------------------------------------------
+void wavdecodechannel(const WavFile *wav, int channel, int64_t start,
+                      int count, double *x);
+
+//-----------------------------------------------------------------------------
+// wavdecodechannels() converts samples [start, start + count) of every
+// channel in a single pass over the interleaved payload.
+// Input:
+//   wav          : File opened by wavopen().
+//   start        : First sample
+//   count        : The number of samples per channel
+// Output:
+//   x            : wav->channels outputs of count samples, a NULL output
+//                  skips its channel.
+//-----------------------------------------------------------------------------
+void wavdecodechannels(const WavFile *wav, int64_t start, int count,
+                       double *const *x);
+
+//-----------------------------------------------------------------------------
+// wavclose() releases the mapping created by wavopen().
+//-----------------------------------------------------------------------------
+void wavclose(WavFile *wav);
+
+//-----------------------------------------------------------------------------
+// wavwrite() write a mono .wav file.
+// Input:
+//   x          : Input signal
+//   x_length   : Signal length of x [sample]
+//   fs         : Sampling frequency [Hz]
+//   nbit       : Quantization bit [bit], 16 or 24 for integer PCM, 32 for
+//                IEEE float. Other values write 16 bit.
+//   filename   : Name of the output signal.
+// Caution:
+//   Integer samples are x * full scale truncated and saturated, float
+//   samples are not clipped. Files over 4 GB are written as RF64.
+//-----------------------------------------------------------------------------
+void wavwrite(const double *x, int x_length, int fs, int nbit,
+              const char *filename);
+
+//-----------------------------------------------------------------------------
+// WavInfo is the header of a .wav file as read by wavprobe().
+//   fs, nbit, format, channels : As in WavFile
+//   frames      : The number of samples per channel in the data chunk
+//   data_offset : File offset of the first byte of the data chunk payload
+//   data_size   : Size of the payload in bytes, clamped to the file
+//-----------------------------------------------------------------------------
+typedef struct {
+  int fs;
+  int nbit;
+  int format;
+  int channels;
+  int64_t frames;
+  uint64_t data_offset;
+  uint64_t data_size;
+} WavInfo;
+
+//-----------------------------------------------------------------------------
+// wavprobe() reads only the header of a .wav file. The chunks are walked with
+// positioned reads through a 4 KB buffer, the payload is never mapped or
+// read, so probing costs an open and usually one read whatever the file size.
+// Input:
+//   filename     : Filename of the input file.
+// Output:
+//   info         : The header, zeroed unless 1 is returned.
+//   1 on success, 0 if the file cannot be opened and -1 if the file is not
+//   a supported .wav file.
+//-----------------------------------------------------------------------------
+int wavprobe(const char *filename, WavInfo *info);
+
+//-----------------------------------------------------------------------------
+// GetAudioLength() returns the length of .wav file, read with wavprobe().
+// Input:
+//   filename     : Filename of a .wav file.
+// Output:
+//   The number of samples per channel of the file .wav, -1 when it does not
+//   fit an int. wavprobe() gives the 64 bit count.
+//-----------------------------------------------------------------------------
+int GetAudioLength(const char *filename);
+
+//-----------------------------------------------------------------------------
+// wavread() read a .wav file, the first channel of a multichannel one.
+// The memory of output x must be allocated in advance.
+// Input:
+//   filename     : Filename of the input file.
+// Output:
+//   fs           : Sampling frequency [Hz]
+//   nbit         : Quantization bit [bit]
+//   x            : The output waveform.
+//-----------------------------------------------------------------------------
+void wavread(const char *filename, int *fs, int *nbit, double *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // WORLD_AUDIOIO_H_
@@ -0,0 +1,60 @@
+/*
+ * @file decimator.hpp
+ * @brief polyphase anti aliased sample rate reduction ahead of the f0
+ * estimator
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef DECIMATOR_HPP
+#define DECIMATOR_HPP
+
+#include <vector>
+
+/*
+ * @brief Decimator class
+ * @detail resamples by up / down, the ratio of the analysis rate to the input
+ * rate, with a kaiser windowed sinc low pass cut below the output nyquist.
+ * the filter is stored as one phase per output offset so every output sample
+ * is a single dot product over the input. when the ratio reduces to too many
+ * phases an integer factor is used instead, the output rate then stays above
+ * the one asked for.
+ */
+class Decimator {
+ public:
+  /*
+   * @brief prepare the filter, kept as long as fs and rate do not change
+   * @param fs == input sampling rate
+   * @param rate == highest output rate wanted, 0 == no decimation
+   * @return output sampling rate, fs when there is nothing to decimate
+   */
+  int configure(int fs, double rate);
+
+  //! the output rate differs from the input rate
+  bool active() const { return up != down; }
+
+  int outputRate() const { return outRate; }
+
+  //! number of output samples for length input samples
+  int outputLength(int length) const;
+
+  /*
+   * @brief y[0, outputLength(length)) from x[0, length), samples beyond x are
+   * taken as zero
+   */
+  void run(const double *x, int length, double *y) const;
+
+ private:
+  int inRate{};
+  double asked{-1.0};
+  int outRate{};
+  int up{1};
+  int down{1};
+  int width{};
+  //! phase p holds taps [p * width, (p + 1) * width)
+  std::vector<double> taps;
+};
+
+#endif  // DECIMATOR_HPP
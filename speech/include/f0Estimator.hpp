@@ -0,0 +1,145 @@
+/*
+ * @file f0Estimator.hpp
+ * @brief run the f0 estimator selected by SpeechOptions
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef F0ESTIMATOR_HPP
+#define F0ESTIMATOR_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "decimator.hpp"
+#include "speech.hpp"
+
+/*
+ * @brief fill x[0, count) with samples [start, start + count). a count always
+ * fits an int, the position in a long recording may not.
+ */
+using SampleReader =
+    std::function<void(std::int64_t start, int count, double *x)>;
+
+/*
+ * @brief receive the next count f0 frames, in order
+ */
+using FrameSink = std::function<void(const double *f0, int count)>;
+
+/*
+ * @brief frames [first, first + count) of the f0 track
+ */
+struct FrameRange {
+  int first;
+  int count;
+};
+
+/*
+ * @brief F0Scratch struct
+ * @detail buffers of one block, kept between blocks so the steady state does
+ * not allocate. the decimator keeps its filter while the rates do not change.
+ */
+struct F0Scratch {
+  std::vector<double> x;
+  std::vector<double> temporalPositions;
+  std::vector<double> f0;
+  std::vector<double> refined;
+  std::vector<double> block;
+  Decimator decimator;
+  std::vector<double> decimated;
+  std::vector<double> decimatedPositions;
+  std::vector<double> decimatedF0;
+};
+
+/*
+ * @brief fill options with harvest and the world default frame period and f0
+ * range
+ */
+void initializeF0Options(SpeechOptions *options);
+
+/*
+ * @brief check the options before any work is done
+ * @return true when the estimator and its parameters are usable
+ */
+bool validF0Options(const SpeechOptions &options);
+
+/*
+ * @brief number of f0 frames the selected estimator produces for length
+ * samples at fs. the count itself must fit an int.
+ */
+int getSamplesForF0(const SpeechOptions &options, int fs, std::int64_t length);
+
+/*
+ * @brief estimateF0
+ * @detail harvest, or dio followed by stonemask when options.stonemask is
+ * set. more detail about harvest or dio can be found in the world doc.
+ * temporalPositions and f0 must hold getSamplesForF0 frames. x is first
+ * decimated to options.analysis_rate when fs is above it, the frames keep the
+ * grid of fs. scratch holds the buffers and the decimation filter, temporary
+ * ones are used when it is nullptr.
+ */
+void estimateF0(const SpeechOptions &options, const double *x, int length,
+                int fs, double *temporalPositions, double *f0,
+                F0Scratch *scratch = nullptr);
+
+/*
+ * @brief estimateF0Range
+ * @detail estimate the global frames [firstFrame, firstFrame + numOfFrame) of
+ * a signal of length samples. only the samples under those frames plus
+ * marginFrames of context on both sides are read, and the block starts on the
+ * frame grid so consecutive ranges join without a seam.
+ */
+void estimateF0Range(const SpeechOptions &options, int fs, std::int64_t length,
+                     int firstFrame, int numOfFrame, int marginFrames,
+                     const SampleReader &read, F0Scratch &scratch,
+                     double *f0);
+
+/*
+ * @brief estimateF0Blocks
+ * @detail estimate the whole signal block by block as set by
+ * options.block_length and options.block_margin. peak memory is one block
+ * plus its margins whatever the signal length, held by scratch.
+ */
+void estimateF0Blocks(const SpeechOptions &options, int fs, std::int64_t length,
+                      const SampleReader &read, const FrameSink &sink,
+                      F0Scratch &scratch);
+
+/*
+ * @brief estimateF0Regions
+ * @detail estimate only the frames of regions, sorted and not overlapping,
+ * block by block like estimateF0Blocks when options.block_length is set,
+ * otherwise each region in one piece which must then hold less than 2^31
+ * samples. either way options.block_margin of context is read on both sides
+ * of every piece. the sink still receives every frame of the signal, the ones
+ * out of the regions as unvoiced.
+ */
+void estimateF0Regions(const SpeechOptions &options, int fs,
+                       std::int64_t length,
+                       const std::vector<FrameRange> &regions,
+                       const SampleReader &read, const FrameSink &sink,
+                       F0Scratch &scratch);
+
+/*
+ * @brief estimateF0Segments
+ * @param f0 == receive every frame of the signal, the ones out of the regions
+ * as unvoiced
+ * @param scratch == one scratch per segment estimated at once, grown as
+ * needed and kept between calls
+ * @detail estimate the frames of regions with the longer ones cut into
+ * segments run concurrently on the shared thread pool, as many at once as
+ * options.parallel allows. a cut is moved to the quietest point near its
+ * place so that voiced runs are rarely split, and where the frame period
+ * allows onto a frame that keeps the segment on the sample grid of the whole
+ * signal. every segment reads options.block_margin of context on both sides
+ * like a region does. x is read from several threads at once.
+ */
+void estimateF0Segments(const SpeechOptions &options, int fs,
+                        std::int64_t length,
+                        const std::vector<FrameRange> &regions,
+                        const SampleReader &read,
+                        std::vector<F0Scratch> &scratch, double *f0);
+
+#endif  // F0ESTIMATOR_HPP
@@ -0,0 +1,84 @@
+/*
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef PCMCONVERT_H_
+#define PCMCONVERT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// PcmKernels is a table of little-endian PCM to double conversion kernels.
+// Every kernel converts n samples from src into dst scaled to [-1, 1).
+//   u8     : unsigned 8 bit, 128 is the zero line
+//   s16    : signed 16 bit
+//   s24    : signed 24 bit, packed 3 bytes per sample
+//   s32    : signed 32 bit
+//   f32    : IEEE float 32 bit, copied without scaling
+//   f64    : IEEE float 64 bit, copied without scaling
+//   alaw   : G.711 A-law 8 bit, expanded to the 16 bit linear scale
+//   mulaw  : G.711 mu-law 8 bit, expanded to the 16 bit linear scale
+//   name   : Instruction set the table was built for
+//-----------------------------------------------------------------------------
+typedef struct {
+  void (*u8)(const unsigned char *src, int n, double *dst);
+  void (*s16)(const unsigned char *src, int n, double *dst);
+  void (*s24)(const unsigned char *src, int n, double *dst);
+  void (*s32)(const unsigned char *src, int n, double *dst);
+  void (*f32)(const unsigned char *src, int n, double *dst);
+  void (*f64)(const unsigned char *src, int n, double *dst);
+  void (*alaw)(const unsigned char *src, int n, double *dst);
+  void (*mulaw)(const unsigned char *src, int n, double *dst);
+  const char *name;
+} PcmKernels;
+
+//-----------------------------------------------------------------------------
+// GetPcmKernels() returns the fastest kernel table supported by the running
+// CPU. The CPU is probed once, later calls return the cached table.
+//-----------------------------------------------------------------------------
+const PcmKernels *GetPcmKernels(void);
+
+//-----------------------------------------------------------------------------
+// GetScalarPcmKernels() returns the portable table. It is the reference the
+// vectorized kernels must match.
+//-----------------------------------------------------------------------------
+const PcmKernels *GetScalarPcmKernels(void);
+
+//-----------------------------------------------------------------------------
+// PcmEncoders is the opposite table, double to little-endian PCM for
+// wavwrite(). Every encoder converts n samples from src into dst.
+//   s16    : signed 16 bit, x * 32767 truncated and saturated
+//   s24    : signed 24 bit packed 3 bytes per sample, x * 8388607 truncated
+//            and saturated
+//   f32    : IEEE float 32 bit, rounded without scaling or clipping
+//   name   : Instruction set the table was built for
+// NaN saturates to the negative limit of the integer formats.
+//-----------------------------------------------------------------------------
+typedef struct {
+  void (*s16)(const double *src, int n, unsigned char *dst);
+  void (*s24)(const double *src, int n, unsigned char *dst);
+  void (*f32)(const double *src, int n, unsigned char *dst);
+  const char *name;
+} PcmEncoders;
+
+//-----------------------------------------------------------------------------
+// GetPcmEncoders() returns the fastest encoder table of the running CPU,
+// probed once like GetPcmKernels().
+//-----------------------------------------------------------------------------
+const PcmEncoders *GetPcmEncoders(void);
+
+//-----------------------------------------------------------------------------
+// GetScalarPcmEncoders() returns the portable encoders, the reference of the
+// vectorized ones.
+//-----------------------------------------------------------------------------
+const PcmEncoders *GetScalarPcmEncoders(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PCMCONVERT_H_
@@ -0,0 +1,209 @@
+/*
+ * @file pitchStats.hpp
+ * @brief pitch statistics over an f0 track
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef PITCHSTATS_HPP
+#define PITCHSTATS_HPP
+
+#include <vector>
+
+#include "speech.hpp"
+
+/*
+ * @brief PitchStats struct
+ * @detail everything getPitch1,2,3,4 need, gathered in one pass
+ * - frames == number of f0 frames
+ * - voiced == number of frames with f0 != 0
+ * - sum == sum of every frame
+ * - voicedSum == sum of voiced frames
+ * - variance == population variance of every frame
+ * - firstHalfSum == sum of frame [0, frames / 2)
+ * - headSum == sum of frame [0, frames - 5)
+ * - last == the last frame, the whole tail getPitch4 has always summed
+ */
+struct PitchStats {
+  int frames{};
+  int voiced{};
+  double sum{};
+  double voicedSum{};
+  double variance{};
+  double firstHalfSum{};
+  double headSum{};
+  double last{};
+
+  double mean() const { return sum / frames; }
+  double voicedMean() const { return voicedSum / voiced; }
+
+  //! average value for f0
+  double pitch1() const { return sum / frames; }
+  //! standard deviation of f0
+  double pitch2() const;
+  //! average of last half minus average of first half
+  double pitch3() const;
+  //! the last frame over 5 minus average of the frames before the last 5
+  double pitch4() const;
+};
+
+/*
+ * @brief PitchAccumulator class
+ * @detail fused single pass statistics kernel. the total number of frames
+ * must be known up front because the half split and tail boundaries depend on
+ * it, the frames themselves can arrive in any number of push calls.
+ * the variance is accumulated with welford's update on independent simd
+ * lanes which are merged with chan's formula, so it stays numerically stable
+ * without a second pass.
+ */
+class PitchAccumulator {
+ public:
+  explicit PitchAccumulator(int totalFrames = 0);
+
+  void push(const double *f0, int count);
+
+  PitchStats finish() const;
+
+  /*
+   * @brief partial moments of a range of frames
+   */
+  struct Moments {
+    double count{};
+    double mean{};
+    double m2{};
+    double sum{};
+    double voiced{};
+    double voicedSum{};
+  };
+
+ private:
+  int total{};
+  int position{};
+  //! frame index where the segments end, sorted
+  int bound[2]{};
+  //! [0, bound0) [bound0, bound1) [bound1, total)
+  Moments segment[3]{};
+  double last{};
+};
+
+/*
+ * @brief RunningPitch class
+ * @detail statistics of a track whose length is not known yet, as of the
+ * frames pushed so far. the track is kept because the half split point moves
+ * while frames arrive, its storage is allocated once by the constructor.
+ */
+class RunningPitch {
+ public:
+  explicit RunningPitch(int capacity = 0);
+
+  /*
+   * @return frames accepted, less than count once the capacity is reached
+   */
+  int push(const double *f0, int count);
+
+  PitchStats stats() const;
+
+  const double *frames() const { return track.data(); }
+  int size() const { return count; }
+
+ private:
+  std::vector<double> track;
+  int count{};
+  int half{};
+  double halfSum{};
+  PitchAccumulator::Moments all{};
+};
+
+/*
+ * @brief VoicedStats struct
+ * @detail statistics of the voiced frames alone, unvoiced frames are neither
+ * counted nor averaged. only the fields of flags are computed, the others
+ * stay 0, and a statistic without any voiced frame is nan.
+ * - flags == SpeechVoicedStat bits computed
+ * - frames == number of f0 frames
+ * - voiced == number of frames with f0 != 0
+ * - mean, sd == mean and population standard deviation in Hz
+ * - semitoneMean, semitoneSd == the same in semitones re 100 Hz
+ * - jitter == mean absolute difference of consecutive voiced periods over the
+ * mean period
+ * - median == in Hz
+ * - percentile == in Hz, in the order they were asked
+ */
+struct VoicedStats {
+  unsigned flags{};
+  int frames{};
+  int voiced{};
+  double mean{};
+  double sd{};
+  double semitoneMean{};
+  double semitoneSd{};
+  double jitter{};
+  double median{};
+  int percentileCount{};
+  double percentile[SPEECH_PERCENTILES_MAX]{};
+
+  double ratio() const {
+    return frames > 0 ? static_cast<double>(voiced) / frames : 0.0;
+  }
+};
+
+/*
+ * @brief VoicedAccumulator class
+ * @detail single pass over the f0 track, pushed in any number of calls. the
+ * moments are welford updates over the voiced frames, the median and the
+ * percentiles are selected in o(n) from the voiced values kept in values.
+ */
+class VoicedAccumulator {
+ public:
+  /*
+   * @param flags == SpeechVoicedStat bits to compute
+   * @param values == storage for the voiced f0, kept by the caller so its
+   * capacity is reused. only filled for the median and percentiles.
+   */
+  VoicedAccumulator(unsigned flags, std::vector<double> &values);
+
+  void push(const double *f0, int count);
+
+  /*
+   * @param percentiles == in [0, 100], linearly interpolated between the
+   * closest ranks
+   * @param count == number of percentiles, SPEECH_PERCENTILES_MAX at most
+   * @detail reorders the kept values
+   */
+  VoicedStats finish(const double *percentiles, int count);
+
+ private:
+  unsigned flags;
+  std::vector<double> &values;
+  int frames{};
+  int voiced{};
+  double mean{};
+  double m2{};
+  double semitoneMean{};
+  double semitoneM2{};
+  double previous{};
+  double periodSum{};
+  double periodChange{};
+  int pairs{};
+};
+
+/*
+ * @brief computePitchStats
+ * @param f0 data array
+ * @param dat_length f0 array length
+ * @return statistics of the whole track in one pass
+ */
+PitchStats computePitchStats(const double *f0, int dat_length);
+
+/*
+ * @brief reference implementation, one pass per statistic. kept to check and
+ * benchmark the fused kernel against.
+ */
+double getPitch1(const double *dat, int const dat_length);
+double getPitch2(const double *dat, int const dat_length);
+double getPitch3(const double *dat, int const dat_length);
+double getPitch4(const double *dat, int const dat_length);
+
+#endif  // PITCHSTATS_HPP
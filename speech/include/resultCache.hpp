@@ -0,0 +1,141 @@
+/*
+ * @file resultCache.hpp
+ * @brief analysis results keyed by a hash of the pcm payload and options
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef RESULTCACHE_HPP
+#define RESULTCACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pitchStats.hpp"
+
+/*
+ * @brief hashBytes
+ * @param data == bytes to hash
+ * @param size == number of bytes
+ * @param seed == start value, chain calls by passing the previous hash
+ * @return 64 bit hash, 4 independent multiply rotate lanes so it runs close
+ * to memory bandwidth. not cryptographic.
+ */
+std::uint64_t hashBytes(const void *data, std::size_t size,
+                        std::uint64_t seed = 0);
+
+/*
+ * @brief CacheKey struct
+ * - pcm == hash of the raw payload bytes, before decoding
+ * - options == hash of the sample format and the analysis options
+ * - length == number of samples, a cheap extra check against collisions
+ */
+struct CacheKey {
+  std::uint64_t pcm{};
+  std::uint64_t options{};
+  std::int64_t length{};
+
+  bool operator==(const CacheKey &other) const {
+    return pcm == other.pcm && options == other.options &&
+           length == other.length;
+  }
+};
+
+/*
+ * @brief ResultCache class
+ * @detail two tiers:
+ * - memory == least recently used entries up to a fixed count
+ * - disk == optional, an open addressing index file mapped in memory plus
+ * a data file in a directory, written as a ring so it never grows past a
+ * fixed size. the entries it overwrites are dropped from the index. a disk
+ * hit is promoted to memory.
+ * every call locks, one instance is shared by all contexts and batch workers.
+ * the disk tier belongs to one process at a time, an exclusive lock on the
+ * index file is held while it is open.
+ */
+class ResultCache {
+ public:
+  ResultCache() = default;
+  ~ResultCache();
+
+  ResultCache(const ResultCache &) = delete;
+  ResultCache &operator=(const ResultCache &) = delete;
+
+  //! what configure did with the disk tier
+  enum DiskState { DiskReady, DiskFailed, DiskLocked };
+
+  /*
+   * @brief drop every memory entry and reopen the disk tier
+   * @param entries == memory tier size, 0 disables the cache
+   * @param directory == disk tier location, nullptr or "" for memory only
+   * @return DiskReady when the disk tier is open or not asked for,
+   * DiskLocked when another process holds it, DiskFailed when it cannot be
+   * opened. the memory tier is configured anyway.
+   */
+  DiskState configure(std::size_t entries, const char *directory);
+
+  bool enabled() const { return capacity > 0; }
+
+  /*
+   * @param stats == receive the stored statistics on a hit
+   * @param f0 == receive the stored f0 track on a hit
+   * @return true on a hit
+   */
+  bool find(const CacheKey &key, PitchStats &stats, std::vector<double> &f0);
+
+  void insert(const CacheKey &key, const PitchStats &stats,
+              const std::vector<double> &f0);
+
+  /*
+   * @brief process wide cache, disabled until configured. never destroyed,
+   * like ThreadPool::shared().
+   */
+  static ResultCache &shared();
+
+ private:
+  struct Entry {
+    PitchStats stats;
+    std::vector<double> f0;
+  };
+  struct KeyHash {
+    std::size_t operator()(const CacheKey &k) const {
+      return static_cast<std::size_t>(k.pcm ^ k.options);
+    }
+  };
+  using Lru = std::list<std::pair<CacheKey, Entry>>;
+
+  void remember(const CacheKey &key, Entry entry);
+  DiskState openDisk(const std::string &directory);
+  void closeDisk();
+  bool diskFind(const CacheKey &key, Entry &entry);
+  void diskInsert(const CacheKey &key, const Entry &entry);
+
+  std::mutex lock;
+  //! atomic so enabled() can read it without the lock
+  std::atomic<std::size_t> capacity{};
+  Lru lru;
+  std::unordered_map<CacheKey, Lru::iterator, KeyHash> index;
+
+  //! disk tier
+  void *indexMap{};
+  std::size_t indexSize{};
+  std::FILE *data{};
+#if defined(_WIN32)
+  void *indexFile{};
+  void *indexMapping{};
+#else
+  int indexFile{-1};
+#endif
+};
+
+#endif  // RESULTCACHE_HPP
@@ -0,0 +1,67 @@
+/*
+ * @file resultWriter.hpp
+ * @brief analysis result record and its allocation free json serializer
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef RESULTWRITER_HPP
+#define RESULTWRITER_HPP
+
+#include <cstddef>
+
+#include "pitchStats.hpp"
+#include "stageTimer.hpp"
+
+/*
+ * @brief AnalysisResult struct
+ * @detail everything the json result holds, as plain values. the defaults
+ * are the ones of jsonResultDefault, an error result keeps them.
+ * - status == 0 or an errCode
+ * - comment == errCode text, truncated to fit
+ * - pitch == pitch 1,2,3,4
+ * - stats == statistics the pitches were computed from, zero on error
+ * - voiced == the voiced frame statistics asked for by the options
+ */
+struct AnalysisResult {
+  int status{};
+  char comment[128]{};
+  double pitch[4]{2.1, 4.6, 6.7, 8.3};
+  PitchStats stats{};
+  VoicedStats voiced{};
+
+  void reset() { *this = AnalysisResult{}; }
+
+  /*
+   * @brief set status and comment, detail is appended to the comment
+   */
+  void setStatus(int code, const char *text, const char *detail = nullptr);
+
+  void setPitch(const PitchStats &from);
+};
+
+/*
+ * @brief writeResultJson
+ * @param result == result to serialize
+ * @param channels == per channel results added as a "channels" array of
+ * objects with the keys of result, nullptr for none. a "voiced" object holds
+ * the voiced statistics of a result that has any.
+ * @param channelCount == number of channels
+ * @param timings == stages to add as a "timings" object, nullptr for none
+ * @param dst == receive the json and a terminating zero, may be nullptr when
+ * capacity is 0
+ * @param capacity == size of dst in bytes
+ * @return bytes needed including the terminating zero. nothing but an empty
+ * string is written when it exceeds capacity, a cut json is never handed out.
+ * @detail same text as nlohmann::json::dump() of the equivalent document:
+ * sorted keys, the same double digits, null for nan and inf. no memory is
+ * allocated.
+ */
+std::size_t writeResultJson(const AnalysisResult &result,
+                            const AnalysisResult *channels, int channelCount,
+                            const StageClock *timings, char *dst,
+                            std::size_t capacity);
+
+#endif  // RESULTWRITER_HPP
@@ -1,37 +1,304 @@
-/*
-Authored by Suka Isnaini on 9th of August 2021
-Created for PT Sejahtera Empati Pratama
-All Copyrights belong to PT Sejahtera Empati Pratama
-*/
-
-#include <string>
-#ifndef SPEECH_HPP
-#define SPEECH_HPP
-
-#if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || \
-    defined(__MINGW32__)
-#define DLLEXPORT __declspec(dllexport)
-#define ADDCALL __stdcall
-#ifdef _MSVC_VER
-#endif
-#else
-#define DLLEXPORT
-#define ADDCALL
-#define fopen_s(pFile, filename, mode) \
-  ((*(pFile)) = fopen((filename), (mode))) == NULL
-typedef int errno_t;
-#endif
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-DLLEXPORT int ADDCALL PitchAnalyzer(char* const, char* const);
-
-DLLEXPORT char* ADDCALL PitchAnalyzer2(const char*);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif  // SPEECH_HPP
+/*
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include <string>
+#ifndef SPEECH_HPP
+#define SPEECH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * @brief bytes that always hold a json result including the terminating zero,
+ * the per channel results of a multichannel file aside
+ */
+#define SPEECH_RESULT_MAX 1024
+
+#if defined(_WIN32) || defined(_WIN64) || defined(__WIN32__) || \
+    defined(__MINGW32__)
+#define DLLEXPORT __declspec(dllexport)
+#define ADDCALL __stdcall
+#ifdef _MSVC_VER
+#endif
+#else
+#define DLLEXPORT
+#define ADDCALL
+#define fopen_s(pFile, filename, mode) \
+  ((*(pFile)) = fopen((filename), (mode))) == NULL
+typedef int errno_t;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief f0 estimator, more detail about harvest or dio can be found in the
+ * world doc. harvest is more accurate, dio is many times faster.
+ */
+enum SpeechEstimator { SpeechEstimatorDio = 0, SpeechEstimatorHarvest = 1 };
+
+/*
+ * @brief statistics over the voiced frames only, or-ed into
+ * SpeechOptions.voiced_stats. each one is only computed when asked for, the
+ * median and the percentiles keep the voiced f0 for an o(n) selection.
+ * - mean == mean and standard deviation in Hz
+ * - semitone == mean and standard deviation in semitones re 100 Hz
+ * - jitter == mean absolute difference of consecutive voiced periods over
+ *   the mean period, from the f0 frames
+ * - median, percentiles == of the voiced f0 in Hz, percentiles as listed in
+ *   SpeechOptions.percentiles
+ * the voiced ratio comes with any of them.
+ */
+enum SpeechVoicedStat {
+  SpeechStatMean = 1,
+  SpeechStatSemitone = 2,
+  SpeechStatJitter = 4,
+  SpeechStatMedian = 8,
+  SpeechStatPercentiles = 16
+};
+
+/*
+ * @brief most percentiles one analysis computes
+ */
+#define SPEECH_PERCENTILES_MAX 8
+
+/*
+ * @brief analysis options
+ * - estimator == SpeechEstimator value
+ * - stonemask == non zero to refine the dio f0 with stonemask
+ * - frame_period == f0 frame period in ms
+ * - f0_floor == lowest f0 searched in Hz
+ * - f0_ceil == highest f0 searched in Hz
+ * - block_length == seconds of audio analyzed at a time, 0 == whole file.
+ *   memory then stays bounded by the block instead of the file length
+ * - block_margin == seconds of context added on both sides of a block
+ * - timings == non zero adds the time spent per stage to the json result,
+ *   summed over the channels of a multichannel file
+ * - vad == non zero estimates f0 only over the speech regions found by an
+ *   energy and zero crossing detector, the rest is unvoiced. a file without
+ *   speech then fails fast with 2000. 0 by default, the whole signal is
+ *   estimated
+ * - analysis_rate == 0, or the sampling rate in Hz input above it is
+ *   decimated to before f0 estimation. 8000 to 16000 keeps the pitch while
+ *   the estimator does a fraction of the work, it must exceed 2 * f0_ceil
+ * - voiced_stats == SpeechVoicedStat bits, 0 == pitch 1,2,3,4 only
+ * - percentile_count, percentiles == percentiles in [0, 100] computed with
+ *   SpeechStatPercentiles
+ * - parallel == 0, or the signal is cut at quiet points into overlapping
+ *   segments of 10 s at least, estimated concurrently on the shared thread
+ *   pool. 1 == as many at once as the pool has threads, n == at most n and
+ *   never more than one over the pool threads. the segments overlap by
+ *   block_margin like the regions of the single threaded run do, a few
+ *   frames next to the cuts or on a frame time half way between two samples
+ *   may still differ from it. block mode ignores it
+ */
+typedef struct {
+  int estimator;
+  int stonemask;
+  double frame_period;
+  double f0_floor;
+  double f0_ceil;
+  double block_length;
+  double block_margin;
+  int timings;
+  int vad;
+  double analysis_rate;
+  unsigned voiced_stats;
+  int percentile_count;
+  double percentiles[SPEECH_PERCENTILES_MAX];
+  int parallel;
+} SpeechOptions;
+
+DLLEXPORT void ADDCALL SpeechInitializeOptions(SpeechOptions*);
+
+/*
+ * @brief analysis result as plain values, the same numbers as the json
+ * - status == 0 or the error code of the json status
+ * - frames == number of f0 frames
+ * - pitch1 .. pitch4 == as in the json, 0 unless status is 0 or 2005
+ * - voiced_ratio == share of frames with f0 != 0
+ * - elapsed_ms == time spent by the analysis, summed over the channels of a
+ *   multichannel file so it can exceed the wall time
+ * - voiced_mean .. percentiles == the SpeechVoicedStat values asked for by
+ *   the options, 0 otherwise and nan when there is no voiced frame
+ */
+typedef struct {
+  int status;
+  int frames;
+  double pitch1;
+  double pitch2;
+  double pitch3;
+  double pitch4;
+  double voiced_ratio;
+  double elapsed_ms;
+  double voiced_mean;
+  double voiced_sd;
+  double semitone_mean;
+  double semitone_sd;
+  double jitter;
+  double median;
+  int percentile_count;
+  double percentiles[SPEECH_PERCENTILES_MAX];
+} PitchResult;
+
+DLLEXPORT int ADDCALL PitchAnalyzer(char* const, char* const);
+
+DLLEXPORT char* ADDCALL PitchAnalyzer2(const char*);
+
+/*
+ * @brief write the json result into dst, return the bytes it needs including
+ * the terminating zero. dst receive an empty string when capacity is short.
+ */
+DLLEXPORT size_t ADDCALL PitchAnalyzerInto(const char* fileName, char* dst,
+                                           size_t capacity);
+
+DLLEXPORT int ADDCALL PitchAnalyzerBatch(const char* const*, int, char**,
+                                         const SpeechOptions*);
+
+/*
+ * @brief header of a wav file, read without mapping or decoding the samples
+ * - status == 0, 1000 when the file cannot be opened, 1002 when it is not a
+ *   supported wav file. the other fields are 0 unless status is 0
+ * - fs, nbit, channels == as in the fmt chunk
+ * - format == 1 integer pcm, 3 float, 6 a-law, 7 mu-law
+ * - frames == samples per channel
+ * - data_offset == file offset of the first sample
+ * - duration == frames / fs in seconds
+ */
+typedef struct {
+  int status;
+  int fs;
+  int nbit;
+  int format;
+  int channels;
+  int64_t frames;
+  uint64_t data_offset;
+  double duration;
+} SpeechProbeResult;
+
+/*
+ * @brief probe one file, returns the status
+ */
+DLLEXPORT int ADDCALL SpeechProbe(const char* fileName, SpeechProbeResult* out);
+
+/*
+ * @brief probe count files in parallel into out[0, count), returns the number
+ * of files whose status is not 0
+ */
+DLLEXPORT int ADDCALL SpeechProbeMany(const char* const* fileNames, int count,
+                                      SpeechProbeResult* out);
+
+/*
+ * @brief analyze a file without any json, options may be nullptr
+ */
+DLLEXPORT PitchResult ADDCALL PitchAnalyzeFile(const char* fileName,
+                                               const SpeechOptions* options);
+
+/*
+ * @brief reentrant analysis api. one SpeechContext owns the result of its
+ * analyses, different contexts can be used from different threads at the same
+ * time. a single context must not be used by two threads at once.
+ */
+typedef struct SpeechContext SpeechContext;
+
+DLLEXPORT SpeechContext* ADDCALL SpeechCreate(void);
+
+DLLEXPORT int ADDCALL SpeechSetOptions(SpeechContext*, const SpeechOptions*);
+
+DLLEXPORT int ADDCALL SpeechAnalyze(SpeechContext*, const char*);
+
+/*
+ * @brief analyze audio that is already in memory, the result is read with
+ * SpeechResult like for SpeechAnalyze.
+ */
+DLLEXPORT int ADDCALL PitchAnalyzeBuffer(SpeechContext*, const double* samples,
+                                         int n, int fs);
+
+DLLEXPORT int ADDCALL PitchAnalyzeBufferInt16(SpeechContext*,
+                                              const int16_t* samples, int n,
+                                              int fs);
+
+DLLEXPORT int ADDCALL PitchAnalyzeWavBytes(SpeechContext*, const void* riff,
+                                           size_t len);
+
+DLLEXPORT const char* ADDCALL SpeechResult(SpeechContext*);
+
+DLLEXPORT size_t ADDCALL SpeechResultInto(SpeechContext*, char* dst,
+                                          size_t capacity);
+
+/*
+ * @brief result of the last analysis on the context as plain values, the
+ * json is never built. returns the status.
+ */
+DLLEXPORT int ADDCALL SpeechPitchResult(SpeechContext*, PitchResult* out);
+
+/*
+ * @brief a multichannel file is analyzed channel by channel in parallel. the
+ * json then has a "channels" array with the result of every channel. the
+ * status is 0 when every channel succeed, 2005 when only some did and the
+ * status of the first channel when none did. the pitch and voiced fields,
+ * SpeechPitchResult and SpeechF0 repeat the first channel that succeed, or
+ * the first channel. the count is 0 for mono.
+ */
+DLLEXPORT int ADDCALL SpeechChannelCount(SpeechContext*);
+DLLEXPORT int ADDCALL SpeechChannelPitchResult(SpeechContext*, int channel,
+                                               PitchResult* out);
+
+/*
+ * @brief f0 track of the last analysis on the context, empty in block mode
+ */
+DLLEXPORT const double* ADDCALL SpeechF0(SpeechContext*, int* n);
+
+/*
+ * @brief most bytes the context arena held for one analysis. the arena is
+ * kept between analyses, once it reached this size they allocate nothing.
+ */
+DLLEXPORT size_t ADDCALL SpeechArenaPeak(SpeechContext*);
+
+/*
+ * @brief process wide result cache keyed by the samples and the options.
+ * entries == 0 disables it, directory adds an on disk tier of at most
+ * 256 MB, the oldest entries are overwritten past it. one process at a time
+ * uses a directory, the others get 1005 and keep a memory only cache.
+ */
+DLLEXPORT int ADDCALL SpeechCacheConfigure(size_t entries,
+                                           const char* directory);
+
+/*
+ * @brief cumulative counters and per stage latency histograms as json
+ */
+DLLEXPORT const char* ADDCALL SpeechGetStats(void);
+
+DLLEXPORT void ADDCALL SpeechDestroy(SpeechContext*);
+
+/*
+ * @brief push api for live audio. samples are pushed as they arrive, the f0
+ * frames of every completed block and the running pitch 1,2,3,4 are polled.
+ * a frame is final once block_margin seconds of audio after it have been
+ * pushed, block_length defaults to 1 second for streams. the stream's
+ * buffers and decimation filter are allocated by SpeechStreamCreate for at
+ * most maxSeconds of audio, harvest and dio still allocate their own
+ * temporaries for every block.
+ */
+typedef struct SpeechStream SpeechStream;
+
+DLLEXPORT SpeechStream* ADDCALL SpeechStreamCreate(int fs, double maxSeconds,
+                                                   const SpeechOptions*);
+
+DLLEXPORT int ADDCALL SpeechStreamPush(SpeechStream*, const double* samples,
+                                       int n);
+
+DLLEXPORT int ADDCALL SpeechStreamPoll(SpeechStream*, double* f0,
+                                       int capacity, double* pitch);
+
+DLLEXPORT void ADDCALL SpeechStreamClose(SpeechStream*, double* pitch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // SPEECH_HPP
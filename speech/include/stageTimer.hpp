@@ -0,0 +1,126 @@
+/*
+ * @file stageTimer.hpp
+ * @brief per stage latency of the analysis
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef STAGETIMER_HPP
+#define STAGETIMER_HPP
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * @brief stages of one analysis
+ * - open == mapping the file and parsing the header
+ * - cache == hashing the payload and looking the result up
+ * - decode == converting the samples to double
+ * - vad == finding the speech regions
+ * - f0 == the estimator
+ * - stats == pitch 1,2,3,4 from the f0 track
+ * - serialize == json result to string
+ */
+enum Stage {
+  StageOpen,
+  StageCache,
+  StageDecode,
+  StageVad,
+  StageF0,
+  StageStats,
+  StageSerialize,
+  StageCount
+};
+
+const char *stageName(Stage stage);
+
+/*
+ * @brief time spent per stage by one analysis, in ns. a stage that did not
+ * run stays at -1.
+ */
+struct StageClock {
+  std::int64_t nanos[StageCount];
+
+  StageClock() { reset(); }
+  void reset() {
+    for (auto &n : nanos) n = -1;
+  }
+  void add(Stage stage, std::int64_t ns) {
+    nanos[stage] = (nanos[stage] < 0 ? 0 : nanos[stage]) + ns;
+  }
+  double ms(Stage stage) const { return nanos[stage] * 1e-6; }
+};
+
+/*
+ * @brief StageTimer class
+ * @detail adds the steady clock time between construction and destruction to
+ * one stage of a clock
+ */
+class StageTimer {
+ public:
+  StageTimer(StageClock &clock, Stage stage)
+      : clock(clock), stage(stage), start(std::chrono::steady_clock::now()) {}
+  ~StageTimer() {
+    clock.add(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count());
+  }
+
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+ private:
+  StageClock &clock;
+  Stage stage;
+  std::chrono::steady_clock::time_point start;
+};
+
+/*
+ * @brief histogram upper bounds in microseconds, one more bucket holds
+ * everything above the last bound
+ */
+const int kStageBuckets = 8;
+extern const double kStageBucketBound[kStageBuckets - 1];
+
+/*
+ * @brief cumulative counters of every thread
+ * - analyses == analyses started
+ * - errors == analyses that returned a non zero status
+ * - cacheHits == analyses answered from the result cache
+ * - count, nanos == runs and total time per stage
+ * - histogram == runs per stage and latency bucket
+ */
+struct StageTotals {
+  std::uint64_t analyses{};
+  std::uint64_t errors{};
+  std::uint64_t cacheHits{};
+  std::uint64_t count[StageCount]{};
+  std::uint64_t nanos[StageCount]{};
+  std::uint64_t histogram[StageCount][kStageBuckets]{};
+};
+
+/*
+ * @brief add one analysis to the calling thread's counters. the counters
+ * are thread local, recording never takes a lock or contends with other
+ * threads.
+ * @param clock == stages that ran, the ones at -1 are skipped
+ * @param status == result status of the analysis
+ * @param cacheHit == the result came from the cache
+ */
+void recordAnalysis(const StageClock &clock, int status, bool cacheHit);
+
+/*
+ * @brief add stages that do not belong to an analysis, e.g. serialization
+ * which happens after the result is complete
+ */
+void recordStages(const StageClock &clock);
+
+/*
+ * @brief sum of the counters of every thread that ever recorded, including
+ * threads that have exited
+ */
+StageTotals stageTotals();
+
+#endif  // STAGETIMER_HPP
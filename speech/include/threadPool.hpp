@@ -0,0 +1,87 @@
+/*
+ * @file threadPool.hpp
+ * @brief fixed size work stealing thread pool
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * @brief ThreadPool class
+ * @detail every worker owns a deque. run() deals the tasks round robin over
+ * the deques in the given order, a worker takes from the front of its own
+ * deque and steals from the back of the others when it runs dry. submitting
+ * the most expensive tasks first therefore keeps long jobs starting early and
+ * leaves the short ones for balancing at the end.
+ * the thread calling run() helps executing queued tasks until its own tasks
+ * are done, so run() may be called from inside a task without deadlocking.
+ */
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  /*
+   * @param threads == number of workers, 0 == one per hardware thread
+   */
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /*
+   * @brief run all tasks and block until every one of them has finished.
+   * tasks must not throw.
+   */
+  void run(std::vector<Task> &tasks);
+
+  unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+  /*
+   * @brief process wide pool sized to the hardware. it is never destroyed so
+   * unloading the library does not have to join threads.
+   */
+  static ThreadPool &shared();
+
+ private:
+  struct Group {
+    std::mutex lock;
+    std::condition_variable done;
+    std::size_t pending{};
+  };
+  struct Item {
+    Task task;
+    Group *group{};
+  };
+  struct Queue {
+    std::mutex lock;
+    std::deque<Item> items;
+  };
+
+  bool tryRun(unsigned self);
+  void workerLoop(unsigned self);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex sleepLock;
+  std::condition_variable wake;
+  std::size_t queued{};
+  bool stop{};
+  std::atomic<unsigned> next{};
+};
+
+#endif  // THREADPOOL_HPP
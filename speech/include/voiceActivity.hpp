@@ -0,0 +1,52 @@
+/*
+ * @file voiceActivity.hpp
+ * @brief energy and zero crossing voice activity detector, finds the frames
+ * worth running the f0 estimator on
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef VOICEACTIVITY_HPP
+#define VOICEACTIVITY_HPP
+
+#include <vector>
+
+#include "f0Estimator.hpp"
+
+/*
+ * @brief VadScratch struct
+ * @detail buffers of the detector, kept between analyses so the steady state
+ * does not allocate
+ * - x == samples of one chunk
+ * - level == frame energy in dB
+ * - rate == frame zero crossings per second
+ * - sorted == level sorted partially for the noise floor
+ * - regions == the speech found by the last detectSpeech
+ */
+struct VadScratch {
+  std::vector<double> x;
+  std::vector<float> level;
+  std::vector<float> rate;
+  std::vector<float> sorted;
+  std::vector<FrameRange> regions;
+};
+
+/*
+ * @brief detectSpeech
+ * @param options == analysis options, gives the frame grid
+ * @param fs == sampling rate
+ * @param length == number of samples
+ * @param read == sample source, read once from start to end in chunks
+ * @param scratch == receive the speech regions in scratch.regions
+ * @detail a frame is speech when its energy stands out of the noise floor of
+ * the file and its zero crossing rate is low enough for voiced sound. speech
+ * runs are padded and merged across short pauses, so the regions can be
+ * estimated independently without losing voiced frames at their edges. no
+ * region means no speech at all.
+ */
+void detectSpeech(const SpeechOptions &options, int fs, std::int64_t length,
+                  const SampleReader &read, VadScratch &scratch);
+
+#endif  // VOICEACTIVITY_HPP
@@ -0,0 +1,83 @@
+/*
+ * @file arena.cpp
+ * @brief bump allocator for the buffers of one analysis
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+//! smallest block, below it the bookkeeping is not worth it
+const std::size_t kMinBlock = 64 * 1024;
+
+std::size_t alignUp(std::size_t x) {
+  return (x + Arena::kAlign - 1) & ~(Arena::kAlign - 1);
+}
+
+}  // namespace
+
+Arena::~Arena() {
+  for (auto &b : blocks) std::free(b.raw);
+}
+
+void Arena::addBlock(std::size_t size) {
+  void *raw = std::malloc(size + kAlign);
+  if (!raw) throw std::bad_alloc();
+  auto address = reinterpret_cast<std::uintptr_t>(raw);
+  char *data = reinterpret_cast<char *>(alignUp(address));
+  try {
+    blocks.push_back(Block{raw, data, size});
+  } catch (...) {
+    std::free(raw);
+    throw;
+  }
+}
+
+void *Arena::allocate(std::size_t bytes) {
+  bytes = alignUp(std::max<std::size_t>(bytes, 1));
+  while (current < blocks.size() && offset + bytes > blocks[current].size) {
+    current++;
+    offset = 0;
+  }
+  if (current == blocks.size()) {
+    std::size_t last = blocks.empty() ? 0 : blocks.back().size;
+    addBlock(std::max({bytes, 2 * last, kMinBlock}));
+    offset = 0;
+  }
+  void *ret = blocks[current].data + offset;
+  offset += bytes;
+  usedBytes += bytes;
+  peakBytes = std::max(peakBytes, usedBytes);
+  return ret;
+}
+
+void Arena::reset() {
+  if (blocks.size() > 1) {
+    std::size_t total = capacity();
+    for (auto &b : blocks) std::free(b.raw);
+    blocks.clear();
+    //! on failure the arena is just empty, the next allocate tries again
+    try {
+      addBlock(total);
+    } catch (std::bad_alloc &) {
+    }
+  }
+  current = 0;
+  offset = 0;
+  usedBytes = 0;
+}
+
+std::size_t Arena::capacity() const {
+  std::size_t ret{};
+  for (auto &b : blocks) ret += b.size;
+  return ret;
+}
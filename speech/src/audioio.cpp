@@ -1,279 +1,670 @@
-//-----------------------------------------------------------------------------
-// Copyright 2012 Masanori Morise
-// Author: mmorise [at] meiji.ac.jp (Masanori Morise)
-// Last update: 2021/02/15
-//
-// .wav input/output functions were modified for compatibility with C language.
-// Since these functions (wavread() and wavwrite()) are roughly implemented,
-// we recommend more suitable functions provided by other organizations.
-// This file is independent of WORLD project and for the test.cpp.
-//-----------------------------------------------------------------------------
-
-/*
-Edited by Suka Isnaini on 9th of August 2021
-Created for PT Sejahtera Empati Pratama
-All Copyrights belong to PT Sejahtera Empati Pratama
-*/
-
-#include "./audioio.h"
-
-#include <math.h>
-#include <stdint.h>
-#include <stdio.h>
-#include <string.h>
-
-#if (defined(__WIN32__) || defined(_WIN32)) && !defined(__MINGW32__)
-#pragma warning(disable : 4996)
-#else
-#define fopen_s(pFile, filename, mode) \
-  ((*(pFile)) = fopen((filename), (mode))) == NULL
-typedef int errno_t;
-#endif
-
-namespace {
-
-static inline int MyMaxInt(int x, int y) { return x > y ? x : y; }
-
-static inline int MyMinInt(int x, int y) { return x < y ? x : y; }
-
-//-----------------------------------------------------------------------------
-// CheckHeader() checks the .wav header. This function can only support the
-// monaural wave file. This function is only used in waveread().
-//-----------------------------------------------------------------------------
-static int CheckHeader(FILE *fp) {
-  char data_check[5];
-  fread(data_check, 1, 4, fp);  // "RIFF"
-  data_check[4] = '\0';
-  if (0 != strcmp(data_check, "RIFF")) {
-    printf("RIFF error.\n");
-    return 0;
-  }
-  fseek(fp, 4, SEEK_CUR);
-  fread(data_check, 1, 4, fp);  // "WAVE"
-  if (0 != strcmp(data_check, "WAVE")) {
-    printf("WAVE error.\n");
-    return 0;
-  }
-  fread(data_check, 1, 4, fp);  // "fmt "
-  if (0 != strcmp(data_check, "fmt ")) {
-    printf("fmt error.\n");
-    return 0;
-  }
-  fread(data_check, 1, 4, fp);  // 1 0 0 0
-  // dirty fix for wav maker that add additional format marker eventhough none
-  // used
-  bool additionalFormatFix{};
-  if (0x12 == data_check[0]) additionalFormatFix = 1;
-
-  if (!((16 == data_check[0] || 0x12 == data_check[0]) && 0 == data_check[1] &&
-        0 == data_check[2] && 0 == data_check[3])) {
-    printf("fmt (2) error.\n");
-    return 0;
-  }
-
-  fread(data_check, 1, 2, fp);  // 1 0
-  if (!(1 == data_check[0] && 0 == data_check[1])) {
-    printf("Format ID error.\n");
-    return 0;
-  }
-  fread(data_check, 1, 2, fp);  // 1 0
-  if (!(1 == data_check[0] && 0 == data_check[1])) {
-    printf("This function cannot support stereo file\n");
-    return 0;
-  }
-  return additionalFormatFix ? 12 : 1;
-}
-
-//-----------------------------------------------------------------------------
-// GetParameters() extracts fp, nbit, wav_length from the .wav file
-// This function is only used in wavread().
-//-----------------------------------------------------------------------------
-static int GetParameters(FILE *fp, int *fs, int *nbit, int *wav_length) {
-  char data_check[5] = {0};
-  data_check[4] = '\0';
-  unsigned char for_int_number[4];
-  fread(for_int_number, 1, 4, fp);
-  *fs = 0;
-  for (int i = 3; i >= 0; --i) *fs = *fs * 256 + for_int_number[i];
-  // Quantization
-  fseek(fp, 6, SEEK_CUR);
-  fread(for_int_number, 1, 2, fp);
-  *nbit = for_int_number[0];
-
-  // Skip until "data" is found. 2011/03/28
-  while (0 != fread(data_check, 1, 1, fp)) {
-    if (data_check[0] == 'd') {
-      fread(&data_check[1], 1, 3, fp);
-      if (0 != strcmp(data_check, "data"))
-        fseek(fp, -3, SEEK_CUR);
-      else
-        break;
-    }
-  }
-  if (0 != strcmp(data_check, "data")) {
-    printf("data error.\n");
-    return 0;
-  }
-
-  fread(for_int_number, 1, 4, fp);  // "data"
-  *wav_length = 0;
-  for (int i = 3; i >= 0; --i)
-    *wav_length = *wav_length * 256 + for_int_number[i];
-  *wav_length /= (*nbit / 8);
-  return 1;
-}
-
-}  // namespace
-
-void wavwrite(const double *x, int x_length, int fs, int nbit,
-              const char *filename) {
-  FILE *fp{};
-  int err = fopen_s(&fp, filename, "wb");
-  if (err) {
-    printf("file cannot be oppened.\n");
-    return;
-  }
-
-  char text[4] = {'R', 'I', 'F', 'F'};
-  uint32_t long_number = 36 + x_length * 2;
-  fwrite(text, 1, 4, fp);
-  fwrite(&long_number, 4, 1, fp);
-
-  text[0] = 'W';
-  text[1] = 'A';
-  text[2] = 'V';
-  text[3] = 'E';
-  fwrite(text, 1, 4, fp);
-  text[0] = 'f';
-  text[1] = 'm';
-  text[2] = 't';
-  text[3] = ' ';
-  fwrite(text, 1, 4, fp);
-
-  long_number = 16;
-  fwrite(&long_number, 4, 1, fp);
-  int16_t short_number = 1;
-  fwrite(&short_number, 2, 1, fp);
-  short_number = 1;
-  fwrite(&short_number, 2, 1, fp);
-  long_number = fs;
-  fwrite(&long_number, 4, 1, fp);
-  long_number = fs * 2;
-  fwrite(&long_number, 4, 1, fp);
-  short_number = 2;
-  fwrite(&short_number, 2, 1, fp);
-  short_number = 16;
-  fwrite(&short_number, 2, 1, fp);
-
-  text[0] = 'd';
-  text[1] = 'a';
-  text[2] = 't';
-  text[3] = 'a';
-  fwrite(text, 1, 4, fp);
-  long_number = x_length * 2;
-  fwrite(&long_number, 4, 1, fp);
-
-  int16_t tmp_signal;
-  for (int i = 0; i < x_length; ++i) {
-    tmp_signal = static_cast<int16_t>(
-        MyMaxInt(-32768, MyMinInt(32767, static_cast<int>(x[i] * 32767))));
-    fwrite(&tmp_signal, 2, 1, fp);
-  }
-
-  fclose(fp);
-}
-
-int GetAudioLength(const char *filename) {
-  FILE *fp{};
-  errno_t err{};
-  err = fopen_s(&fp, filename, "rb");
-  if (err) {
-    return 0;
-  }
-
-  // kenzanin fix
-  bool fix{};
-  int ch = CheckHeader(fp);
-  if (0 == ch) {
-    fclose(fp);
-    return -1;
-  } else if (0x12 == ch) {
-    fix = 1;
-  }
-
-  char data_check[5] = {0};
-  data_check[4] = '\0';
-  unsigned char for_int_number[4];
-
-  // Quantization
-  fseek(fp, 10 + (fix == 0 ? 0 : 2), SEEK_CUR);
-  fread(for_int_number, 1, 2, fp);
-  int nbit = for_int_number[0];
-
-  while (0 != fread(data_check, 1, 1, fp)) {
-    if ('d' == data_check[0]) {
-      fread(&data_check[1], 1, 3, fp);
-      if (0 != strcmp(data_check, "data"))
-        fseek(fp, -3, SEEK_CUR);
-      else
-        break;
-    }
-  }
-  if (0 != strcmp(data_check, "data")) {
-    fclose(fp);
-    return -1;
-  }
-
-  fread(for_int_number, 1, 4, fp);  // "data"
-  fclose(fp);
-
-  int wav_length = 0;
-  for (int i = 3; i >= 0; --i)
-    wav_length = wav_length * 256 + for_int_number[i];
-  wav_length /= (nbit / 8);
-
-  return wav_length;
-}
-
-void wavread(const char *filename, int *fs, int *nbit, double *x) {
-  FILE *fp{};
-  errno_t err{};
-  err = fopen_s(&fp, filename, "rb");
-  if (err) {
-    printf("File not found.\n");
-    return;
-  }
-  // kenzanin fix
-  bool fix{};
-  int ch = CheckHeader(fp);
-  if (0 == ch) {
-    fclose(fp);
-    return;
-  } else if (0x12 == ch) {
-    fix = 1;
-  }
-
-  int x_length;
-  if (0 == GetParameters(fp, fs, nbit, &x_length)) {
-    fclose(fp);
-    return;
-  }
-
-  int quantization_byte = *nbit / 8;
-  double zero_line = pow(2.0, *nbit - 1);
-  double tmp, sign_bias;
-  unsigned char for_int_number[4];
-  for (int i = 0; i < x_length; ++i) {
-    sign_bias = tmp = 0.0;
-    fread(for_int_number, 1, quantization_byte, fp);  // "data"
-    if (for_int_number[quantization_byte - 1] >= 128) {
-      sign_bias = pow(2.0, *nbit - 1);
-      for_int_number[quantization_byte - 1] =
-          for_int_number[quantization_byte - 1] & 0x7F;
-    }
-    for (int j = quantization_byte - 1; j >= 0; --j)
-      tmp = tmp * 256.0 + for_int_number[j];
-    x[i] = (tmp - sign_bias) / zero_line;
-  }
-  fclose(fp);
-}
+//-----------------------------------------------------------------------------
+// Copyright 2012 Masanori Morise
+// Author: mmorise [at] meiji.ac.jp (Masanori Morise)
+// Last update: 2021/02/15
+//
+// .wav input/output functions were modified for compatibility with C language.
+// Since these functions (wavread() and wavwrite()) are roughly implemented,
+// we recommend more suitable functions provided by other organizations.
+// This file is independent of WORLD project and for the test.cpp.
+//-----------------------------------------------------------------------------
+
+/*
+Edited by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "./audioio.h"
+
+#include "./pcmconvert.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__WIN32__) || defined(_WIN32)) && !defined(__MINGW32__)
+#pragma warning(disable : 4996)
+#else
+#define fopen_s(pFile, filename, mode) \
+  ((*(pFile)) = fopen((filename), (mode))) == NULL
+typedef int errno_t;
+#endif
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+static inline int MyMaxInt(int x, int y) { return x > y ? x : y; }
+
+static inline int MyMinInt(int x, int y) { return x < y ? x : y; }
+
+// Interleaved samples converted at a time, small enough to stay in L1.
+static const int kDeinterleaveSamples = 2048;
+
+// More channels than a chunk holds frames of are not supported.
+static const int kMaxChannels = 256;
+
+//-----------------------------------------------------------------------------
+// MapFile() maps the whole file read-only. An empty file cannot be mapped and
+// is reported as a valid but empty mapping so that the header check rejects it.
+//-----------------------------------------------------------------------------
+static int MapFile(const char *filename, const void **base, size_t *size) {
+  *base = NULL;
+  *size = 0;
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (INVALID_HANDLE_VALUE == file) return 0;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    return 0;
+  }
+  if (0 == file_size.QuadPart) {
+    CloseHandle(file);
+    return 1;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (NULL == mapping) return 0;
+  *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (NULL == *base) return 0;
+  *size = static_cast<size_t>(file_size.QuadPart);
+#else
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return 0;
+  struct stat st;
+  if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return 0;
+  }
+  if (0 == st.st_size) {
+    close(fd);
+    return 1;
+  }
+  void *p = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE,
+                 fd, 0);
+  close(fd);
+  if (MAP_FAILED == p) return 0;
+  madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+  *base = p;
+  *size = static_cast<size_t>(st.st_size);
+#endif
+  return 1;
+}
+
+static void UnmapFile(const void *base, size_t size) {
+  if (NULL == base) return;
+#if defined(_WIN32)
+  (void)size;
+  UnmapViewOfFile(base);
+#else
+  munmap(const_cast<void *>(base), size);
+#endif
+}
+
+static inline uint32_t ReadU32(const unsigned char *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static inline uint16_t ReadU16(const unsigned char *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint64_t ReadU64(const unsigned char *p) {
+  return ReadU32(p) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32);
+}
+
+// Tail of the KSDATAFORMAT_SUBTYPE GUIDs, the first two bytes are the format.
+static const unsigned char kSubFormatTail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+    0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+//-----------------------------------------------------------------------------
+// ParseFormat() reads a "fmt " chunk body, plain or WAVE_FORMAT_EXTENSIBLE.
+//-----------------------------------------------------------------------------
+static int ParseFormat(const unsigned char *p, uint64_t size, WavFile *wav) {
+  if (size < 16) {
+    printf("fmt (2) error.\n");
+    return 0;
+  }
+  wav->format = ReadU16(p);
+  if (0xFFFE == wav->format) {
+    if (size < 40 || 0 != memcmp(p + 26, kSubFormatTail, 14)) {
+      printf("Format ID error.\n");
+      return 0;
+    }
+    wav->format = ReadU16(p + 24);
+  }
+  // 1 integer PCM, 3 IEEE float, 6 G.711 A-law, 7 G.711 mu-law
+  if (1 != wav->format && 3 != wav->format && 6 != wav->format &&
+      7 != wav->format) {
+    printf("Format ID error.\n");
+    return 0;
+  }
+  wav->channels = ReadU16(p + 2);
+  if (wav->channels < 1 || wav->channels > kMaxChannels) {
+    printf("Channel error.\n");
+    return 0;
+  }
+  uint32_t fs = ReadU32(p + 4);
+  if (0 == fs || fs > INT_MAX) {
+    printf("Sampling frequency error.\n");
+    return 0;
+  }
+  wav->fs = static_cast<int>(fs);
+  // the container width, extensible files may declare fewer valid bits
+  wav->nbit = ReadU16(p + 14);
+  int quantization_byte = wav->nbit / 8;
+  bool quantization_error = false;
+  if (1 == wav->format)
+    quantization_error = quantization_byte < 1 || quantization_byte > 4;
+  else if (3 == wav->format)
+    quantization_error = 4 != quantization_byte && 8 != quantization_byte;
+  else
+    quantization_error = 8 != wav->nbit;
+  if (quantization_error) {
+    printf("Quantization error.\n");
+    return 0;
+  }
+  if (ReadU16(p + 12) != wav->channels * quantization_byte) {
+    printf("Block align error.\n");
+    return 0;
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+// HeaderSource hands the bytes of a file to WalkHeader(), mapped or read on
+// demand. fetch() returns n bytes at offset, at most kMaxFetch, or NULL when
+// they are not in the file. The bytes stay valid until the next fetch().
+//-----------------------------------------------------------------------------
+typedef struct {
+  const unsigned char *(*fetch)(void *source, uint64_t offset, size_t n);
+  void *source;
+  uint64_t size;
+} HeaderSource;
+
+// The longest "fmt " body ParseFormat() looks at.
+static const size_t kMaxFetch = 40;
+
+typedef struct {
+  const unsigned char *p;
+  uint64_t size;
+} MemoryFile;
+
+static const unsigned char *FetchMemory(void *source, uint64_t offset,
+                                        size_t n) {
+  const MemoryFile *memory = static_cast<const MemoryFile *>(source);
+  if (offset > memory->size || n > memory->size - offset) return NULL;
+  return memory->p + offset;
+}
+
+//-----------------------------------------------------------------------------
+// WalkHeader() walks the RIFF chunks of a .wav file and extracts fs, nbit,
+// the channel count and the position of the data chunk. Chunks are skipped by
+// their size, odd sizes padded to even, so metadata never passes for data.
+// RF64 and BW64 files take the sizes of their ds64 chunk.
+//-----------------------------------------------------------------------------
+static int WalkHeader(const HeaderSource *src, WavFile *wav,
+                      uint64_t *data_offset, uint64_t *data_size) {
+  const unsigned char *p = src->fetch(src->source, 0, 12);
+  bool rf64 = NULL != p && (0 == memcmp(p, "RF64", 4) ||
+                            0 == memcmp(p, "BW64", 4));
+  if (NULL == p || (0 != memcmp(p, "RIFF", 4) && !rf64)) {
+    printf("RIFF error.\n");
+    return 0;
+  }
+  if (0 != memcmp(p + 8, "WAVE", 4)) {
+    printf("WAVE error.\n");
+    return 0;
+  }
+
+  bool format = false;
+  bool data = false;
+  uint64_t ds64_data_size = 0;
+  uint64_t offset = 12;
+  uint64_t size = src->size;
+  while (offset + 8 <= size && (!format || !data)) {
+    const unsigned char *chunk = src->fetch(src->source, offset, 8);
+    if (NULL == chunk) break;
+    char id[4];
+    memcpy(id, chunk, 4);
+    uint64_t chunk_size = ReadU32(chunk + 4);
+    uint64_t body = offset + 8;
+    uint64_t available = size - body;
+    if (0 == memcmp(id, "ds64", 4) && chunk_size >= 16 && available >= 16) {
+      const unsigned char *q = src->fetch(src->source, body, 16);
+      if (NULL != q) ds64_data_size = ReadU64(q + 8);
+    } else if (0 == memcmp(id, "fmt ", 4)) {
+      uint64_t n = chunk_size < available ? chunk_size : available;
+      if (n > kMaxFetch) n = kMaxFetch;
+      const unsigned char *q =
+          src->fetch(src->source, body, static_cast<size_t>(n));
+      if (NULL == q || !ParseFormat(q, n, wav)) return 0;
+      format = true;
+    } else if (0 == memcmp(id, "data", 4)) {
+      data = true;
+      *data_offset = body;
+      *data_size = chunk_size;
+      if (rf64 && 0xFFFFFFFF == chunk_size) *data_size = ds64_data_size;
+      // truncated recordings declare more data than the file holds
+      if (*data_size > available) *data_size = available;
+      // nothing can follow a data chunk of unknown size
+      if (0xFFFFFFFF == chunk_size) break;
+    }
+    offset = body + chunk_size + (chunk_size & 1);
+  }
+  if (!format) {
+    printf("fmt error.\n");
+    return 0;
+  }
+  if (!data) {
+    printf("data error.\n");
+    return 0;
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+// ParseHeader() parses the header of a .wav file in memory and points data at
+// its payload.
+//-----------------------------------------------------------------------------
+static int ParseHeader(const unsigned char *p, size_t size, WavFile *wav) {
+  MemoryFile memory = {p, size};
+  HeaderSource src = {FetchMemory, &memory, size};
+  uint64_t data_offset = 0;
+  uint64_t data_size = 0;
+  if (!WalkHeader(&src, wav, &data_offset, &data_size)) return 0;
+
+  wav->data = p + data_offset;
+  wav->length =
+      static_cast<int64_t>(data_size / (wav->nbit / 8) / wav->channels);
+  return 1;
+}
+
+// Bytes read at a time by wavprobe(), headers rarely need a second read.
+static const size_t kProbeBuffer = 4096;
+
+//-----------------------------------------------------------------------------
+// ProbeFile reads a file through a small window with positioned reads, so
+// probing neither maps the file nor moves a shared file position.
+//-----------------------------------------------------------------------------
+typedef struct {
+#if defined(_WIN32)
+  HANDLE file;
+#else
+  int fd;
+#endif
+  uint64_t start;
+  size_t filled;
+  unsigned char buffer[kProbeBuffer];
+} ProbeFile;
+
+static const unsigned char *FetchFile(void *source, uint64_t offset,
+                                      size_t n) {
+  ProbeFile *file = static_cast<ProbeFile *>(source);
+  if (offset >= file->start && offset + n <= file->start + file->filled)
+    return file->buffer + (offset - file->start);
+  file->start = offset;
+  file->filled = 0;
+#if defined(_WIN32)
+  OVERLAPPED position = {};
+  position.Offset = static_cast<DWORD>(offset);
+  position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD done = 0;
+  if (!ReadFile(file->file, file->buffer, static_cast<DWORD>(kProbeBuffer),
+                &done, &position))
+    return NULL;
+  file->filled = done;
+#else
+  ssize_t done = pread(file->fd, file->buffer, kProbeBuffer,
+                       static_cast<off_t>(offset));
+  if (done < 0) return NULL;
+  file->filled = static_cast<size_t>(done);
+#endif
+  return n <= file->filled ? file->buffer : NULL;
+}
+
+// Samples encoded per write. 64 KB of float32 at most, large enough that
+// stdio hands every block straight to the system.
+static const int kWriteSamples = 16384;
+
+// Largest header WriteHeader() emits, the RF64 form.
+static const int kMaxHeader = 80;
+
+static inline void WriteU16(unsigned char *p, uint32_t v) {
+  p[0] = static_cast<unsigned char>(v);
+  p[1] = static_cast<unsigned char>(v >> 8);
+}
+
+static inline void WriteU32(unsigned char *p, uint32_t v) {
+  WriteU16(p, v);
+  WriteU16(p + 2, v >> 16);
+}
+
+static inline void WriteU64(unsigned char *p, uint64_t v) {
+  WriteU32(p, static_cast<uint32_t>(v));
+  WriteU32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+//-----------------------------------------------------------------------------
+// WriteHeader() fills the header of a mono file with data_size bytes of
+// payload and returns its size. Sizes beyond the 32 bits of RIFF switch to
+// RF64 with a ds64 chunk, the form ParseHeader() reads back.
+//-----------------------------------------------------------------------------
+static int WriteHeader(unsigned char *p, int fs, int nbit, int format,
+                       uint64_t data_size, uint64_t samples) {
+  uint64_t pad = data_size & 1;
+  bool rf64 = 36 + data_size + pad > 0xFFFFFFFF;
+  int header = rf64 ? kMaxHeader : 44;
+  memcpy(p, rf64 ? "RF64" : "RIFF", 4);
+  WriteU32(p + 4, rf64 ? 0xFFFFFFFF
+                       : static_cast<uint32_t>(header - 8 + data_size + pad));
+  memcpy(p + 8, "WAVE", 4);
+  unsigned char *q = p + 12;
+  if (rf64) {
+    memcpy(q, "ds64", 4);
+    WriteU32(q + 4, 28);
+    WriteU64(q + 8, header - 8 + data_size + pad);
+    WriteU64(q + 16, data_size);
+    WriteU64(q + 24, samples);
+    WriteU32(q + 32, 0);
+    q += 36;
+  }
+  int block_align = nbit / 8;
+  memcpy(q, "fmt ", 4);
+  WriteU32(q + 4, 16);
+  WriteU16(q + 8, format);
+  WriteU16(q + 10, 1);
+  WriteU32(q + 12, fs);
+  WriteU32(q + 16, static_cast<uint32_t>(fs) * block_align);
+  WriteU16(q + 20, block_align);
+  WriteU16(q + 22, nbit);
+  memcpy(q + 24, "data", 4);
+  WriteU32(q + 28, rf64 ? 0xFFFFFFFF : static_cast<uint32_t>(data_size));
+  return header;
+}
+
+}  // namespace
+
+void wavwrite(const double *x, int x_length, int fs, int nbit,
+              const char *filename) {
+  const PcmEncoders *encoders = GetPcmEncoders();
+  void (*encode)(const double *, int, unsigned char *) = encoders->s16;
+  int format = 1;
+  if (24 == nbit) {
+    encode = encoders->s24;
+  } else if (32 == nbit) {
+    encode = encoders->f32;
+    format = 3;
+  } else {
+    nbit = 16;
+  }
+  int quantization_byte = nbit / 8;
+  if (x_length < 0) x_length = 0;
+
+  FILE *fp{};
+  int err = fopen_s(&fp, filename, "wb");
+  if (err) {
+    printf("file cannot be oppened.\n");
+    return;
+  }
+  unsigned char *buffer = static_cast<unsigned char *>(
+      malloc(kMaxHeader + static_cast<size_t>(kWriteSamples) * 4 + 1));
+  if (NULL == buffer) {
+    printf("memory error.\n");
+    fclose(fp);
+    return;
+  }
+
+  uint64_t data_size = static_cast<uint64_t>(x_length) * quantization_byte;
+  // the header goes out with the first block
+  size_t fill = WriteHeader(buffer, fs, nbit, format, data_size, x_length);
+  bool ok = true;
+  int done = 0;
+  do {
+    int count = MyMinInt(kWriteSamples, x_length - done);
+    encode(x + done, count, buffer + fill);
+    fill += static_cast<size_t>(count) * quantization_byte;
+    done += count;
+    // odd payloads are padded to keep the chunk even
+    if (done == x_length && (data_size & 1)) buffer[fill++] = 0;
+    ok = fwrite(buffer, 1, fill, fp) == fill;
+    fill = 0;
+  } while (ok && done < x_length);
+
+  free(buffer);
+  if (0 != fclose(fp) || !ok) printf("file write error.\n");
+}
+
+int wavopen(const char *filename, WavFile *wav) {
+  wav->base = NULL;
+  wav->size = 0;
+  wav->data = NULL;
+  wav->length = 0;
+  if (0 == MapFile(filename, &wav->base, &wav->size)) return 0;
+  if (0 == ParseHeader(static_cast<const unsigned char *>(wav->base),
+                       wav->size, wav)) {
+    wavclose(wav);
+    return -1;
+  }
+  return 1;
+}
+
+int wavparse(const void *bytes, size_t size, WavFile *wav) {
+  wav->base = NULL;
+  wav->size = 0;
+  wav->data = NULL;
+  wav->length = 0;
+  if (NULL == bytes) return -1;
+  if (0 == ParseHeader(static_cast<const unsigned char *>(bytes), size, wav))
+    return -1;
+  return 1;
+}
+
+void wavclose(WavFile *wav) {
+  UnmapFile(wav->base, wav->size);
+  wav->base = NULL;
+  wav->size = 0;
+  wav->data = NULL;
+}
+
+void wavdecode(const WavFile *wav, double *x) {
+  // count is an int, a longer payload goes in pieces
+  const int64_t piece = 1 << 30;
+  for (int64_t done = 0; done < wav->length; done += piece) {
+    int64_t n = wav->length - done < piece ? wav->length - done : piece;
+    wavdecoderange(wav, done, static_cast<int>(n), x + done);
+  }
+}
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// DecodeSamples() converts count packed samples in the format of wav.
+//-----------------------------------------------------------------------------
+static void DecodeSamples(const WavFile *wav, const unsigned char *src,
+                          int count, double *x) {
+  const PcmKernels *kernels = GetPcmKernels();
+  int quantization_byte = wav->nbit / 8;
+  if (6 == wav->format || 7 == wav->format) {
+    if (6 == wav->format)
+      kernels->alaw(src, count, x);
+    else
+      kernels->mulaw(src, count, x);
+    return;
+  }
+  if (3 == wav->format) {
+    if (32 == wav->nbit)
+      kernels->f32(src, count, x);
+    else
+      kernels->f64(src, count, x);
+    return;
+  }
+  switch (quantization_byte) {
+    case 1:
+      kernels->u8(src, count, x);
+      break;
+    case 2:
+      kernels->s16(src, count, x);
+      break;
+    case 3:
+      kernels->s24(src, count, x);
+      break;
+    case 4:
+      kernels->s32(src, count, x);
+      break;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// DecodeInterleaved() converts count consecutive samples of the payload, the
+// channels interleaved as they are stored.
+//-----------------------------------------------------------------------------
+static void DecodeInterleaved(const WavFile *wav, size_t first, int count,
+                              double *x) {
+  DecodeSamples(wav, wav->data + first * (wav->nbit / 8), count, x);
+}
+
+}  // namespace
+
+void wavdecoderange(const WavFile *wav, int64_t start, int count,
+                    double *x) {
+  wavdecodechannel(wav, 0, start, count, x);
+}
+
+void wavdecodechannel(const WavFile *wav, int channel, int64_t start,
+                      int count, double *x) {
+  if (wav->channels <= 1) {
+    DecodeInterleaved(wav, static_cast<size_t>(start), count, x);
+    return;
+  }
+  // gather the bytes of the one channel, then convert only those
+  unsigned char packed[kDeinterleaveSamples * 8];
+  int width = wav->nbit / 8;
+  size_t stride = static_cast<size_t>(wav->channels) * width;
+  const unsigned char *src =
+      wav->data + static_cast<size_t>(start) * stride + channel * width;
+  for (int done = 0; done < count; done += kDeinterleaveSamples) {
+    int n = MyMinInt(kDeinterleaveSamples, count - done);
+    for (int i = 0; i < n; ++i, src += stride)
+      memcpy(packed + i * width, src, width);
+    DecodeSamples(wav, packed, n, x + done);
+  }
+}
+
+void wavdecodechannels(const WavFile *wav, int64_t start, int count,
+                       double *const *x) {
+  int channels = MyMaxInt(wav->channels, 1);
+  if (1 == channels) {
+    if (NULL != x[0]) {
+      DecodeInterleaved(wav, static_cast<size_t>(start), count, x[0]);
+    }
+    return;
+  }
+  // convert a chunk with the vector kernels, then scatter it per channel
+  double chunk[kDeinterleaveSamples];
+  int frames = kDeinterleaveSamples / channels;
+  for (int done = 0; done < count; done += frames) {
+    int n = MyMinInt(frames, count - done);
+    DecodeInterleaved(wav, static_cast<size_t>(start + done) * channels,
+                      n * channels, chunk);
+    for (int c = 0; c < channels; ++c) {
+      double *dst = x[c];
+      if (NULL == dst) continue;
+      dst += done;
+      for (int i = 0; i < n; ++i) dst[i] = chunk[i * channels + c];
+    }
+  }
+}
+
+int wavprobe(const char *filename, WavInfo *info) {
+  memset(info, 0, sizeof(*info));
+  ProbeFile file;
+  file.start = 0;
+  file.filled = 0;
+  uint64_t size = 0;
+#if defined(_WIN32)
+  file.file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (INVALID_HANDLE_VALUE == file.file) return 0;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file.file, &file_size)) {
+    CloseHandle(file.file);
+    return 0;
+  }
+  size = static_cast<uint64_t>(file_size.QuadPart);
+#else
+  file.fd = open(filename, O_RDONLY);
+  if (file.fd < 0) return 0;
+  struct stat st;
+  if (0 != fstat(file.fd, &st) || !S_ISREG(st.st_mode)) {
+    close(file.fd);
+    return 0;
+  }
+  size = static_cast<uint64_t>(st.st_size);
+#endif
+
+  HeaderSource src = {FetchFile, &file, size};
+  WavFile wav;
+  uint64_t data_offset = 0;
+  uint64_t data_size = 0;
+  int ok = WalkHeader(&src, &wav, &data_offset, &data_size);
+#if defined(_WIN32)
+  CloseHandle(file.file);
+#else
+  close(file.fd);
+#endif
+  if (!ok) return -1;
+
+  info->fs = wav.fs;
+  info->nbit = wav.nbit;
+  info->format = wav.format;
+  info->channels = wav.channels;
+  info->frames =
+      static_cast<int64_t>(data_size / (wav.nbit / 8) / wav.channels);
+  info->data_offset = data_offset;
+  info->data_size = data_size;
+  return 1;
+}
+
+int GetAudioLength(const char *filename) {
+  WavInfo info;
+  int err = wavprobe(filename, &info);
+  if (1 != err) return err;
+  if (info.frames > 0x7FFFFFFF) {
+    printf("data error.\n");
+    return -1;
+  }
+  return static_cast<int>(info.frames);
+}
+
+void wavread(const char *filename, int *fs, int *nbit, double *x) {
+  WavFile wav;
+  int err = wavopen(filename, &wav);
+  if (0 == err) printf("File not found.\n");
+  if (1 != err) return;
+  *fs = wav.fs;
+  *nbit = wav.nbit;
+  wavdecode(&wav, x);
+  wavclose(&wav);
+}
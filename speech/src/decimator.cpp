@@ -0,0 +1,123 @@
+/*
+ * @file decimator.cpp
+ * @brief polyphase anti aliased sample rate reduction ahead of the f0
+ * estimator
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "decimator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+//! more phases than this cost more table than they save
+const int kMaxPhases = 512;
+//! zero crossings of the sinc on each side of the center
+const int kZeros = 8;
+//! kaiser window shape, about 80 dB of stop band
+const double kBeta = 8.0;
+//! cut off relative to the output nyquist, leaves room for the transition
+const double kCutoff = 0.9;
+
+int gcd(int a, int b) {
+  while (b) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+//! modified bessel function of the first kind, order 0
+double besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 64 && term > 1e-12 * sum; k++) {
+    double h = x / (2.0 * k);
+    term *= h * h;
+    sum += term;
+  }
+  return sum;
+}
+
+}  // namespace
+
+int Decimator::configure(int fs, double rate) {
+  if (fs == inRate && rate == asked) return outRate;
+  inRate = fs;
+  asked = rate;
+  outRate = fs;
+  up = down = 1;
+  width = 0;
+  taps.clear();
+  if (rate <= 0.0 || fs <= rate) return outRate;
+
+  int target = static_cast<int>(rate);
+  int g = gcd(target, fs);
+  up = target / g;
+  down = fs / g;
+  if (up > kMaxPhases) {
+    //! largest integer factor keeping the output rate exact and high enough
+    up = 1;
+    for (down = fs / target; down > 1 && fs % down; down--) {
+    }
+    if (down == 1) return outRate;
+  }
+  outRate = static_cast<int>(static_cast<std::int64_t>(fs) * up / down);
+
+  double cutoff = kCutoff * up / down;
+  int half = static_cast<int>(std::ceil(kZeros / cutoff));
+  width = 2 * half;
+  taps.resize(static_cast<std::size_t>(up) * width);
+  double norm = besselI0(kBeta);
+  for (int p = 0; p < up; p++) {
+    double *h = &taps[static_cast<std::size_t>(p) * width];
+    double sum{};
+    for (int j = 0; j < width; j++) {
+      //! distance of the input sample to the output instant
+      double d = j - half + 1 - static_cast<double>(p) / up;
+      double r = d / half;
+      double window = besselI0(kBeta * std::sqrt(std::max(1.0 - r * r, 0.0)));
+      double x = kPi * cutoff * d;
+      double sinc = d == 0.0 ? 1.0 : std::sin(x) / x;
+      h[j] = cutoff * sinc * window / norm;
+      sum += h[j];
+    }
+    //! unity gain at dc for every phase
+    for (int j = 0; j < width; j++) h[j] /= sum;
+  }
+  return outRate;
+}
+
+int Decimator::outputLength(int length) const {
+  if (!active() || length <= 0) return length;
+  return static_cast<int>(static_cast<std::int64_t>(length - 1) * up / down) +
+         1;
+}
+
+void Decimator::run(const double *x, int length, double *y) const {
+  if (!active()) {
+    std::copy(x, x + length, y);
+    return;
+  }
+  int half = width / 2;
+  int count = outputLength(length);
+  for (int n = 0; n < count; n++) {
+    std::int64_t position = static_cast<std::int64_t>(n) * down;
+    int i = static_cast<int>(position / up);
+    const double *h = &taps[static_cast<std::size_t>(position % up) * width];
+    int first = i - half + 1;
+    int begin = std::max(-first, 0);
+    int end = std::min(width, length - first);
+    double sum{};
+    for (int j = begin; j < end; j++) sum += h[j] * x[first + j];
+    y[n] = sum;
+  }
+}
@@ -0,0 +1,363 @@
+/*
+ * @file f0Estimator.cpp
+ * @brief run the f0 estimator selected by SpeechOptions
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "f0Estimator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <new>
+#include <vector>
+
+#include "threadPool.hpp"
+#include "world/dio.h"
+#include "world/harvest.h"
+#include "world/stonemask.h"
+
+void initializeF0Options(SpeechOptions *options) {
+  HarvestOption harvest{};
+  InitializeHarvestOption(&harvest);
+  options->estimator = SpeechEstimatorHarvest;
+  options->stonemask = 1;
+  options->frame_period = harvest.frame_period;
+  options->f0_floor = harvest.f0_floor;
+  options->f0_ceil = harvest.f0_ceil;
+  options->block_length = 0.0;
+  options->block_margin = 1.0;
+  options->timings = 0;
+  options->vad = 0;
+  options->analysis_rate = 0.0;
+  options->voiced_stats = 0;
+  options->percentile_count = 0;
+  std::fill(options->percentiles,
+            options->percentiles + SPEECH_PERCENTILES_MAX, 0.0);
+  options->parallel = 0;
+}
+
+bool validF0Options(const SpeechOptions &options) {
+  if (options.estimator != SpeechEstimatorHarvest &&
+      options.estimator != SpeechEstimatorDio) {
+    return false;
+  }
+  if (options.percentile_count < 0 ||
+      options.percentile_count > SPEECH_PERCENTILES_MAX) {
+    return false;
+  }
+  for (int i = 0; i < options.percentile_count; i++) {
+    if (!(options.percentiles[i] >= 0.0 && options.percentiles[i] <= 100.0)) {
+      return false;
+    }
+  }
+  return options.frame_period > 0.0 && options.f0_floor > 0.0 &&
+         options.f0_ceil > options.f0_floor && options.block_length >= 0.0 &&
+         options.block_margin >= 0.0 && options.parallel >= 0 &&
+         (options.analysis_rate == 0.0 ||
+          options.analysis_rate > 2.0 * options.f0_ceil);
+}
+
+int getSamplesForF0(const SpeechOptions &options, int fs, std::int64_t length) {
+  //! world counts samples in an int. both estimators put a frame every frame
+  //! period from 0 to the end, the count of a longer signal is done the same
+  if (length > INT_MAX) {
+    return static_cast<int>(1000.0 * length / fs / options.frame_period) + 1;
+  }
+  if (options.estimator == SpeechEstimatorHarvest) {
+    return GetSamplesForHarvest(fs, static_cast<int>(length),
+                                options.frame_period);
+  }
+  return GetSamplesForDIO(fs, static_cast<int>(length), options.frame_period);
+}
+
+namespace {
+
+//! shorter segments would spend more on their margins than they save
+const double kMinSegment = 10.0;
+//! how far a cut may move to find a quiet point, in seconds
+const double kCutSearch = 0.5;
+
+/*
+ * @brief the quietest of the frames first, first + step, .. before last, by
+ * the mean energy over one period of the f0 floor around each frame so that
+ * no voiced frame looks quiet between two pulses
+ */
+int quietestFrame(const SpeechOptions &options, int fs, std::int64_t length,
+                  int first, int last, int step, const SampleReader &read,
+                  std::vector<double> &x, std::vector<double> &energy) {
+  double samplesPerFrame = fs * options.frame_period / 1000.0;
+  double half = 0.5 * fs / options.f0_floor;
+  auto clamp = [length](double v) {
+    return std::min(std::max(static_cast<std::int64_t>(v), std::int64_t{}),
+                    length);
+  };
+  std::int64_t start = clamp(std::floor(first * samplesPerFrame - half));
+  std::int64_t end = clamp(std::ceil((last - 1) * samplesPerFrame + half) + 1);
+  if (end <= start) return first;
+
+  //! prefix sums of the squares, any window is then two lookups
+  int n = static_cast<int>(end - start);
+  x.resize(n);
+  read(start, n, x.data());
+  energy.resize(n + 1);
+  energy[0] = 0.0;
+  for (int i = 0; i < n; i++) energy[i + 1] = energy[i] + x[i] * x[i];
+
+  int best = first;
+  double lowest = HUGE_VAL;
+  for (int j = first; j < last; j += step) {
+    std::int64_t a = clamp(std::round(j * samplesPerFrame - half)) - start;
+    std::int64_t b = clamp(std::round(j * samplesPerFrame + half)) - start;
+    a = std::min<std::int64_t>(std::max<std::int64_t>(a, 0), n);
+    b = std::min<std::int64_t>(std::max<std::int64_t>(b, 0), n);
+    double e = (energy[b] - energy[a]) / std::max<std::int64_t>(b - a, 1);
+    if (e < lowest) {
+      lowest = e;
+      best = j;
+    }
+  }
+  return best;
+}
+
+/*
+ * @brief the estimator alone, at the rate of x
+ */
+void runEstimator(const SpeechOptions &options, const double *x, int length,
+                  int fs, double *temporalPositions, double *f0,
+                  std::vector<double> &refined) {
+  if (options.estimator == SpeechEstimatorHarvest) {
+    HarvestOption option{};
+    InitializeHarvestOption(&option);
+    option.frame_period = options.frame_period;
+    option.f0_floor = options.f0_floor;
+    option.f0_ceil = options.f0_ceil;
+    Harvest(x, length, fs, &option, temporalPositions, f0);
+    return;
+  }
+
+  DioOption option{};
+  InitializeDioOption(&option);
+  option.frame_period = options.frame_period;
+  option.f0_floor = options.f0_floor;
+  option.f0_ceil = options.f0_ceil;
+  Dio(x, length, fs, &option, temporalPositions, f0);
+  if (options.stonemask) {
+    int numOfFrame = getSamplesForF0(options, fs, length);
+    refined.resize(numOfFrame);
+    StoneMask(x, length, fs, temporalPositions, f0, numOfFrame,
+              refined.data());
+    std::copy(refined.begin(), refined.end(), f0);
+  }
+}
+
+}  // namespace
+
+void estimateF0(const SpeechOptions &options, const double *x, int length,
+                int fs, double *temporalPositions, double *f0,
+                F0Scratch *scratch) {
+  F0Scratch temporary{};
+  if (!scratch) scratch = &temporary;
+  auto &decimator = scratch->decimator;
+  int rate = decimator.configure(fs, options.analysis_rate);
+  if (!decimator.active()) {
+    runEstimator(options, x, length, fs, temporalPositions, f0,
+                 scratch->refined);
+    return;
+  }
+
+  auto &y = scratch->decimated;
+  y.resize(decimator.outputLength(length));
+  decimator.run(x, length, y.data());
+  int local = getSamplesForF0(options, rate, static_cast<int>(y.size()));
+  scratch->decimatedPositions.resize(local);
+  scratch->decimatedF0.resize(local);
+  runEstimator(options, y.data(), static_cast<int>(y.size()), rate,
+               scratch->decimatedPositions.data(), scratch->decimatedF0.data(),
+               scratch->refined);
+
+  //! same frame times at both rates, the counts may differ by the last one
+  int numOfFrame = getSamplesForF0(options, fs, length);
+  for (int i = 0; i < numOfFrame; i++) {
+    temporalPositions[i] = i * options.frame_period / 1000.0;
+    f0[i] = local > 0 ? scratch->decimatedF0[std::min(i, local - 1)] : 0.0;
+  }
+}
+
+void estimateF0Range(const SpeechOptions &options, int fs, std::int64_t length,
+                     int firstFrame, int numOfFrame, int marginFrames,
+                     const SampleReader &read, F0Scratch &scratch,
+                     double *f0) {
+  double samplesPerFrame = fs * options.frame_period / 1000.0;
+  int startFrame = std::max(firstFrame - marginFrames, 0);
+  //! in 64 bit, the margin may run past the int frames of a long signal
+  std::int64_t endFrame =
+      static_cast<std::int64_t>(firstFrame) + numOfFrame + marginFrames;
+  auto start = static_cast<std::int64_t>(std::min<double>(
+      std::round(startFrame * samplesPerFrame), static_cast<double>(length)));
+  auto end = static_cast<std::int64_t>(
+      std::min<double>(std::round(endFrame * samplesPerFrame) + 1,
+                       static_cast<double>(length)));
+
+  int local{};
+  if (end > start) {
+    //! one block, an int like everything world is given
+    int count = static_cast<int>(end - start);
+    scratch.x.resize(count);
+    read(start, count, scratch.x.data());
+    local = getSamplesForF0(options, fs, count);
+    scratch.temporalPositions.resize(local);
+    scratch.f0.resize(local);
+    estimateF0(options, scratch.x.data(), count, fs,
+               scratch.temporalPositions.data(), scratch.f0.data(), &scratch);
+  }
+
+  //! frames past the end of the block are unvoiced
+  for (int i = 0; i < numOfFrame; i++) {
+    int j = firstFrame - startFrame + i;
+    f0[i] = j < local ? scratch.f0[j] : 0.0;
+  }
+}
+
+void estimateF0Blocks(const SpeechOptions &options, int fs, std::int64_t length,
+                      const SampleReader &read, const FrameSink &sink,
+                      F0Scratch &scratch) {
+  std::vector<FrameRange> whole{{0, getSamplesForF0(options, fs, length)}};
+  estimateF0Regions(options, fs, length, whole, read, sink, scratch);
+}
+
+void estimateF0Regions(const SpeechOptions &options, int fs,
+                       std::int64_t length,
+                       const std::vector<FrameRange> &regions,
+                       const SampleReader &read, const FrameSink &sink,
+                       F0Scratch &scratch) {
+  static const double unvoiced[256]{};
+  auto skip = [&sink](int count) {
+    for (; count > 0; count -= 256) sink(unvoiced, std::min(count, 256));
+  };
+
+  int numOfFrame = getSamplesForF0(options, fs, length);
+  int blockFrames = numOfFrame;
+  //! a region gets the same context as a block, not only the vad padding
+  int marginFrames = static_cast<int>(
+      std::ceil(options.block_margin * 1000.0 / options.frame_period));
+  if (options.block_length > 0.0) {
+    blockFrames = std::max(
+        static_cast<int>(options.block_length * 1000.0 / options.frame_period),
+        1);
+  }
+
+  int next{};
+  auto &f0 = scratch.block;
+  for (const auto &region : regions) {
+    int begin = std::max(std::min(region.first, numOfFrame), next);
+    int end = std::min(region.first + region.count, numOfFrame);
+    end = std::max(end, begin);
+    skip(begin - next);
+    f0.resize(std::max<std::size_t>(f0.size(),
+                                    std::min(blockFrames, end - begin)));
+    for (int first = begin; first < end; first += blockFrames) {
+      int count = std::min(blockFrames, end - first);
+      estimateF0Range(options, fs, length, first, count, marginFrames, read,
+                      scratch, f0.data());
+      sink(f0.data(), count);
+    }
+    next = end;
+  }
+  skip(numOfFrame - next);
+}
+
+void estimateF0Segments(const SpeechOptions &options, int fs,
+                        std::int64_t length,
+                        const std::vector<FrameRange> &regions,
+                        const SampleReader &read,
+                        std::vector<F0Scratch> &scratch, double *f0) {
+  auto &pool = ThreadPool::shared();
+  int numOfFrame = getSamplesForF0(options, fs, length);
+  //! the thread calling run helps, one more than the pool runs at once
+  int workers = static_cast<int>(pool.size());
+  if (options.parallel > 1) {
+    workers = std::min(options.parallel, static_cast<int>(pool.size()) + 1);
+  }
+  workers = std::max(workers, 1);
+  double framesPerSecond = 1000.0 / options.frame_period;
+  int minFrames = std::max(static_cast<int>(kMinSegment * framesPerSecond), 1);
+  int search = static_cast<int>(kCutSearch * framesPerSecond);
+  int marginFrames =
+      static_cast<int>(std::ceil(options.block_margin * framesPerSecond));
+
+  //! frames between the ones a whole number of samples from 0. a segment read
+  //! from one of them sees its frames at the very samples the whole signal
+  //! does, 1 when there is no such frame close enough
+  double samplesPerFrame = fs * options.frame_period / 1000.0;
+  int grid{1};
+  for (int q = 1; q <= search; q++) {
+    double samples = q * samplesPerFrame;
+    if (std::fabs(samples - std::round(samples)) < 1e-9 * samples) {
+      grid = q;
+      break;
+    }
+  }
+
+  std::int64_t total{};
+  for (const auto &region : regions) total += region.count;
+  int target = static_cast<int>(std::max<std::int64_t>(
+      minFrames, (total + workers - 1) / workers));
+
+  //! cut every region into about target frames, the cuts on the frames the
+  //! least energy is around
+  if (scratch.empty()) scratch.resize(1);
+  std::vector<FrameRange> segments;
+  for (const auto &region : regions) {
+    int first = std::max(std::min(region.first, numOfFrame), 0);
+    int end = std::min(region.first + region.count, numOfFrame);
+    if (end <= first) continue;
+    int pieces = std::max((end - first) / target, 1);
+    int begin = first;
+    for (int k = 1; k < pieces; k++) {
+      auto offset = static_cast<std::int64_t>(end - first) * k / pieces;
+      int nominal = first + static_cast<int>(offset);
+      int lo = std::max(nominal - search, begin + 1);
+      int hi = std::min(nominal + search + 1, end);
+      //! the segment is read from cut - marginFrames, keep that on the grid
+      lo += ((marginFrames - lo) % grid + grid) % grid;
+      int cut = hi > lo ? quietestFrame(options, fs, length, lo, hi, grid,
+                                        read, scratch[0].x, scratch[0].block)
+                        : nominal;
+      segments.push_back(FrameRange{begin, cut - begin});
+      begin = cut;
+    }
+    segments.push_back(FrameRange{begin, end - begin});
+  }
+
+  std::fill(f0, f0 + numOfFrame, 0.0);
+  workers = std::min(workers, static_cast<int>(segments.size()));
+  if (static_cast<int>(scratch.size()) < workers) scratch.resize(workers);
+
+  //! every worker takes the next segment with a scratch of its own, the
+  //! frames go straight to their place in the track
+  std::atomic<std::size_t> next{};
+  std::atomic<bool> failed{};
+  std::vector<ThreadPool::Task> tasks;
+  tasks.reserve(workers);
+  for (int w = 0; w < workers; w++) {
+    tasks.emplace_back([&, w] {
+      try {
+        for (std::size_t i; (i = next++) < segments.size();) {
+          const auto &segment = segments[i];
+          estimateF0Range(options, fs, length, segment.first, segment.count,
+                          marginFrames, read, scratch[w], f0 + segment.first);
+        }
+      } catch (std::bad_alloc &) {
+        failed = true;
+        next = segments.size();
+      }
+    });
+  }
+  pool.run(tasks);
+  if (failed) throw std::bad_alloc();
+}
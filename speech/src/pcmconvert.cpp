@@ -0,0 +1,578 @@
+/*
+ * @file pcmconvert.cpp
+ * @brief PCM to double conversion kernels used by wavdecode() and the double
+ * to PCM encoders used by wavwrite()
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "pcmconvert.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCM_HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define PCM_HAVE_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define PCM_TARGET_AVX2
+#else
+#define PCM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PCM_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const double kScale8 = 1.0 / 128.0;
+const double kScale16 = 1.0 / 32768.0;
+const double kScale24 = 1.0 / 8388608.0;
+const double kScale32 = 1.0 / 2147483648.0;
+
+// the encoders scale by the positive full scale, as wavwrite() always did
+const double kFull16 = 32767.0;
+const double kFull24 = 8388607.0;
+
+//-----------------------------------------------------------------------------
+// G.711 expansion tables, one double per code already scaled like s16. 256
+// entries are 2 KB each and stay in L1 next to the samples.
+//-----------------------------------------------------------------------------
+struct G711Tables {
+  double alaw[256];
+  double mulaw[256];
+
+  G711Tables() {
+    for (int code = 0; code < 256; ++code) {
+      // A-law: even bits inverted, a set sign bit is positive
+      int a = code ^ 0x55;
+      int exponent = (a >> 4) & 7;
+      int mantissa = a & 15;
+      int magnitude = 0 == exponent
+                          ? (mantissa << 4) + 8
+                          : ((mantissa << 4) + 0x108) << (exponent - 1);
+      alaw[code] = ((a & 0x80) ? magnitude : -magnitude) * kScale16;
+
+      // mu-law: all bits inverted, biased by 0x84, a set sign bit is negative
+      int u = ~code & 0xFF;
+      exponent = (u >> 4) & 7;
+      mantissa = u & 15;
+      magnitude = (((mantissa << 3) + 0x84) << exponent) - 0x84;
+      mulaw[code] = ((u & 0x80) ? -magnitude : magnitude) * kScale16;
+    }
+  }
+};
+
+const G711Tables kG711;
+
+//-----------------------------------------------------------------------------
+// Scalar kernels. They are the reference and also convert the tails the
+// vector kernels leave behind.
+//-----------------------------------------------------------------------------
+static void ScalarU8(const unsigned char *src, int n, double *dst) {
+  for (int i = 0; i < n; ++i) dst[i] = (src[i] - 128) * kScale8;
+}
+
+static void ScalarS16(const unsigned char *src, int n, double *dst) {
+  for (int i = 0; i < n; ++i, src += 2)
+    dst[i] = static_cast<int16_t>(src[0] | (src[1] << 8)) * kScale16;
+}
+
+static void ScalarS24(const unsigned char *src, int n, double *dst) {
+  for (int i = 0; i < n; ++i, src += 3) {
+    uint32_t u = (src[0] << 8) | (src[1] << 16) |
+                 (static_cast<uint32_t>(src[2]) << 24);
+    dst[i] = (static_cast<int32_t>(u) >> 8) * kScale24;
+  }
+}
+
+static void ScalarS32(const unsigned char *src, int n, double *dst) {
+  for (int i = 0; i < n; ++i, src += 4) {
+    int32_t v;
+    memcpy(&v, src, 4);
+    dst[i] = v * kScale32;
+  }
+}
+
+static void ScalarF32(const unsigned char *src, int n, double *dst) {
+  for (int i = 0; i < n; ++i, src += 4) {
+    float v;
+    memcpy(&v, src, 4);
+    dst[i] = v;
+  }
+}
+
+static void ScalarF64(const unsigned char *src, int n, double *dst) {
+  memcpy(dst, src, static_cast<size_t>(n) * 8);
+}
+
+static void ScalarALaw(const unsigned char *src, int n, double *dst) {
+  for (int i = 0; i < n; ++i) dst[i] = kG711.alaw[src[i]];
+}
+
+static void ScalarMuLaw(const unsigned char *src, int n, double *dst) {
+  for (int i = 0; i < n; ++i) dst[i] = kG711.mulaw[src[i]];
+}
+
+// written so that NaN takes lo, as the vector max instructions do
+static inline double Saturate(double v, double lo, double hi) {
+  v = v > lo ? v : lo;
+  return v < hi ? v : hi;
+}
+
+static void ScalarEncodeS16(const double *src, int n, unsigned char *dst) {
+  for (int i = 0; i < n; ++i, dst += 2) {
+    int v = static_cast<int>(Saturate(src[i] * kFull16, -32768.0, 32767.0));
+    dst[0] = static_cast<unsigned char>(v);
+    dst[1] = static_cast<unsigned char>(v >> 8);
+  }
+}
+
+static void ScalarEncodeS24(const double *src, int n, unsigned char *dst) {
+  for (int i = 0; i < n; ++i, dst += 3) {
+    int v =
+        static_cast<int>(Saturate(src[i] * kFull24, -8388608.0, 8388607.0));
+    dst[0] = static_cast<unsigned char>(v);
+    dst[1] = static_cast<unsigned char>(v >> 8);
+    dst[2] = static_cast<unsigned char>(v >> 16);
+  }
+}
+
+static void ScalarEncodeF32(const double *src, int n, unsigned char *dst) {
+  for (int i = 0; i < n; ++i, dst += 4) {
+    float v = static_cast<float>(src[i]);
+    memcpy(dst, &v, 4);
+  }
+}
+
+#if PCM_HAVE_SSE2
+//-----------------------------------------------------------------------------
+// SSE2 kernels. SSE2 is the x86-64 baseline so they need no runtime check.
+// 24 bit needs a byte shuffle and is left to the AVX2 table.
+//-----------------------------------------------------------------------------
+static inline void StoreEpi32(__m128i v, __m128d scale, double *dst) {
+  _mm_storeu_pd(dst, _mm_mul_pd(_mm_cvtepi32_pd(v), scale));
+  _mm_storeu_pd(dst + 2,
+                _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), scale));
+}
+
+static void Sse2U8(const unsigned char *src, int n, double *dst) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(128);
+  const __m128d scale = _mm_set1_pd(kScale8);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+    __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+    StoreEpi32(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), scale,
+               dst + i);
+    StoreEpi32(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), scale,
+               dst + i + 4);
+    StoreEpi32(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), scale,
+               dst + i + 8);
+    StoreEpi32(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), scale,
+               dst + i + 12);
+  }
+  ScalarU8(src + i, n - i, dst + i);
+}
+
+static void Sse2S16(const unsigned char *src, int n, double *dst) {
+  const __m128d scale = _mm_set1_pd(kScale16);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+    StoreEpi32(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), scale, dst + i);
+    StoreEpi32(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), scale,
+               dst + i + 4);
+  }
+  ScalarS16(src + 2 * i, n - i, dst + i);
+}
+
+static void Sse2S32(const unsigned char *src, int n, double *dst) {
+  const __m128d scale = _mm_set1_pd(kScale32);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    StoreEpi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i)),
+        scale, dst + i);
+  }
+  ScalarS32(src + 4 * i, n - i, dst + i);
+}
+
+static void Sse2F32(const unsigned char *src, int n, double *dst) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(reinterpret_cast<const float *>(src + 4 * i));
+    _mm_storeu_pd(dst + i, _mm_cvtps_pd(v));
+    _mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+  ScalarF32(src + 4 * i, n - i, dst + i);
+}
+
+// four doubles scaled, saturated and truncated into the 32 bit lanes
+static inline __m128i Sse2Truncate4(const double *src, __m128d scale,
+                                    __m128d lo, __m128d hi) {
+  __m128d a = _mm_mul_pd(_mm_loadu_pd(src), scale);
+  __m128d b = _mm_mul_pd(_mm_loadu_pd(src + 2), scale);
+  a = _mm_min_pd(_mm_max_pd(a, lo), hi);
+  b = _mm_min_pd(_mm_max_pd(b, lo), hi);
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(a), _mm_cvttpd_epi32(b));
+}
+
+static void Sse2EncodeS16(const double *src, int n, unsigned char *dst) {
+  const __m128d scale = _mm_set1_pd(kFull16);
+  const __m128d lo = _mm_set1_pd(-32768.0);
+  const __m128d hi = _mm_set1_pd(32767.0);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_packs_epi32(Sse2Truncate4(src + i, scale, lo, hi),
+                                Sse2Truncate4(src + i + 4, scale, lo, hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i), v);
+  }
+  ScalarEncodeS16(src + i, n - i, dst + 2 * i);
+}
+
+static void Sse2EncodeF32(const double *src, int n, unsigned char *dst) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_movelh_ps(_mm_cvtpd_ps(_mm_loadu_pd(src + i)),
+                             _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2)));
+    _mm_storeu_ps(reinterpret_cast<float *>(dst + 4 * i), v);
+  }
+  ScalarEncodeF32(src + i, n - i, dst + 4 * i);
+}
+#endif  // PCM_HAVE_SSE2
+
+#if PCM_HAVE_AVX2
+//-----------------------------------------------------------------------------
+// AVX2 kernels, only installed after the CPU and OS support is confirmed.
+//-----------------------------------------------------------------------------
+PCM_TARGET_AVX2 static inline void Store8Epi32(__m256i v, __m256d scale,
+                                               double *dst) {
+  _mm256_storeu_pd(
+      dst, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), scale));
+  _mm256_storeu_pd(dst + 4,
+                   _mm256_mul_pd(
+                       _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)),
+                       scale));
+}
+
+PCM_TARGET_AVX2 static void Avx2U8(const unsigned char *src, int n,
+                                   double *dst) {
+  const __m256i bias = _mm256_set1_epi32(128);
+  const __m256d scale = _mm256_set1_pd(kScale8);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+    Store8Epi32(_mm256_sub_epi32(v, bias), scale, dst + i);
+  }
+  ScalarU8(src + i, n - i, dst + i);
+}
+
+PCM_TARGET_AVX2 static void Avx2S16(const unsigned char *src, int n,
+                                    double *dst) {
+  const __m256d scale = _mm256_set1_pd(kScale16);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i)));
+    Store8Epi32(v, scale, dst + i);
+  }
+  ScalarS16(src + 2 * i, n - i, dst + i);
+}
+
+PCM_TARGET_AVX2 static void Avx2S24(const unsigned char *src, int n,
+                                    double *dst) {
+  // place the 3 bytes of each sample in the top of a 32 bit lane, the
+  // arithmetic shift afterwards restores the sign
+  const __m128i shuffle =
+      _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  const __m256d scale = _mm256_set1_pd(kScale24);
+  int i = 0;
+  // every step loads 16 bytes but consumes 12, stop while 16 are readable
+  for (; i + 6 <= n; i += 4) {
+    __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * i));
+    v = _mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8);
+    _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_cvtepi32_pd(v), scale));
+  }
+  ScalarS24(src + 3 * i, n - i, dst + i);
+}
+
+PCM_TARGET_AVX2 static void Avx2S32(const unsigned char *src, int n,
+                                    double *dst) {
+  const __m256d scale = _mm256_set1_pd(kScale32);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    Store8Epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * i)),
+        scale, dst + i);
+  }
+  ScalarS32(src + 4 * i, n - i, dst + i);
+}
+
+PCM_TARGET_AVX2 static void Avx2F32(const unsigned char *src, int n,
+                                    double *dst) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(reinterpret_cast<const float *>(src + 4 * i));
+    _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    _mm256_storeu_pd(dst + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+  }
+  ScalarF32(src + 4 * i, n - i, dst + i);
+}
+
+// G.711 codes widened to 32 bit indices and gathered from the table, four
+// doubles per gather. The masked form with an explicit source keeps gcc from
+// warning about the uninitialized one of the plain form.
+PCM_TARGET_AVX2 static inline void Avx2Gather8(const double *table,
+                                               const unsigned char *src,
+                                               int n, double *dst) {
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i index = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+    _mm256_storeu_pd(
+        dst + i, _mm256_mask_i32gather_pd(
+                     zero, table, _mm256_castsi256_si128(index), all, 8));
+    _mm256_storeu_pd(
+        dst + i + 4,
+        _mm256_mask_i32gather_pd(
+            zero, table, _mm256_extracti128_si256(index, 1), all, 8));
+  }
+  for (; i < n; ++i) dst[i] = table[src[i]];
+}
+
+PCM_TARGET_AVX2 static void Avx2ALaw(const unsigned char *src, int n,
+                                     double *dst) {
+  Avx2Gather8(kG711.alaw, src, n, dst);
+}
+
+PCM_TARGET_AVX2 static void Avx2MuLaw(const unsigned char *src, int n,
+                                      double *dst) {
+  Avx2Gather8(kG711.mulaw, src, n, dst);
+}
+
+PCM_TARGET_AVX2 static inline __m128i Avx2Truncate4(const double *src,
+                                                   __m256d scale, __m256d lo,
+                                                   __m256d hi) {
+  __m256d v = _mm256_mul_pd(_mm256_loadu_pd(src), scale);
+  return _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(v, lo), hi));
+}
+
+PCM_TARGET_AVX2 static void Avx2EncodeS16(const double *src, int n,
+                                          unsigned char *dst) {
+  const __m256d scale = _mm256_set1_pd(kFull16);
+  const __m256d lo = _mm256_set1_pd(-32768.0);
+  const __m256d hi = _mm256_set1_pd(32767.0);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_packs_epi32(Avx2Truncate4(src + i, scale, lo, hi),
+                                Avx2Truncate4(src + i + 4, scale, lo, hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i), v);
+  }
+  ScalarEncodeS16(src + i, n - i, dst + 2 * i);
+}
+
+PCM_TARGET_AVX2 static void Avx2EncodeS24(const double *src, int n,
+                                          unsigned char *dst) {
+  // the low 3 bytes of each 32 bit lane packed to the front
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  const __m256d scale = _mm256_set1_pd(kFull24);
+  const __m256d lo = _mm256_set1_pd(-8388608.0);
+  const __m256d hi = _mm256_set1_pd(8388607.0);
+  int i = 0;
+  // every step stores 16 bytes but advances 12, stop while 16 are writable
+  for (; i + 6 <= n; i += 4) {
+    __m128i v = _mm_shuffle_epi8(Avx2Truncate4(src + i, scale, lo, hi),
+                                 shuffle);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * i), v);
+  }
+  ScalarEncodeS24(src + i, n - i, dst + 3 * i);
+}
+
+PCM_TARGET_AVX2 static void Avx2EncodeF32(const double *src, int n,
+                                          unsigned char *dst) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(reinterpret_cast<float *>(dst + 4 * i),
+                  _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+  }
+  ScalarEncodeF32(src + i, n - i, dst + 4 * i);
+}
+
+static bool CpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return false;
+  __cpuid(info, 1);
+  // OSXSAVE and AVX, then the OS must save the ymm state
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+  if ((_xgetbv(0) & 6) != 6) return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif  // PCM_HAVE_AVX2
+
+#if PCM_HAVE_NEON
+//-----------------------------------------------------------------------------
+// NEON kernels. AArch64 always has Advanced SIMD with double lanes.
+//-----------------------------------------------------------------------------
+static inline void StoreS32x4(int32x4_t v, float64x2_t scale, double *dst) {
+  vst1q_f64(dst, vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v))), scale));
+  vst1q_f64(dst + 2, vmulq_f64(vcvtq_f64_s64(vmovl_high_s32(v)), scale));
+}
+
+static void NeonU8(const unsigned char *src, int n, double *dst) {
+  const float64x2_t scale = vdupq_n_f64(kScale8);
+  const int16x8_t bias = vdupq_n_s16(128);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v =
+        vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src + i))), bias);
+    StoreS32x4(vmovl_s16(vget_low_s16(v)), scale, dst + i);
+    StoreS32x4(vmovl_high_s16(v), scale, dst + i + 4);
+  }
+  ScalarU8(src + i, n - i, dst + i);
+}
+
+static void NeonS16(const unsigned char *src, int n, double *dst) {
+  const float64x2_t scale = vdupq_n_f64(kScale16);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(src + 2 * i));
+    StoreS32x4(vmovl_s16(vget_low_s16(v)), scale, dst + i);
+    StoreS32x4(vmovl_high_s16(v), scale, dst + i + 4);
+  }
+  ScalarS16(src + 2 * i, n - i, dst + i);
+}
+
+static void NeonS32(const unsigned char *src, int n, double *dst) {
+  const float64x2_t scale = vdupq_n_f64(kScale32);
+  int i = 0;
+  for (; i + 4 <= n; i += 4)
+    StoreS32x4(vreinterpretq_s32_u8(vld1q_u8(src + 4 * i)), scale, dst + i);
+  ScalarS32(src + 4 * i, n - i, dst + i);
+}
+
+static void NeonF32(const unsigned char *src, int n, double *dst) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vreinterpretq_f32_u8(vld1q_u8(src + 4 * i));
+    vst1q_f64(dst + i, vcvt_f64_f32(vget_low_f32(v)));
+    vst1q_f64(dst + i + 2, vcvt_high_f64_f32(v));
+  }
+  ScalarF32(src + 4 * i, n - i, dst + i);
+}
+
+// maxnm rather than max so that NaN takes lo like the other encoders
+static inline int32x4_t NeonTruncate4(const double *src, float64x2_t scale,
+                                      float64x2_t lo, float64x2_t hi) {
+  float64x2_t a = vmulq_f64(vld1q_f64(src), scale);
+  float64x2_t b = vmulq_f64(vld1q_f64(src + 2), scale);
+  a = vminq_f64(vmaxnmq_f64(a, lo), hi);
+  b = vminq_f64(vmaxnmq_f64(b, lo), hi);
+  return vcombine_s32(vmovn_s64(vcvtq_s64_f64(a)),
+                      vmovn_s64(vcvtq_s64_f64(b)));
+}
+
+static void NeonEncodeS16(const double *src, int n, unsigned char *dst) {
+  const float64x2_t scale = vdupq_n_f64(kFull16);
+  const float64x2_t lo = vdupq_n_f64(-32768.0);
+  const float64x2_t hi = vdupq_n_f64(32767.0);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v =
+        vcombine_s16(vqmovn_s32(NeonTruncate4(src + i, scale, lo, hi)),
+                     vqmovn_s32(NeonTruncate4(src + i + 4, scale, lo, hi)));
+    vst1q_u8(dst + 2 * i, vreinterpretq_u8_s16(v));
+  }
+  ScalarEncodeS16(src + i, n - i, dst + 2 * i);
+}
+
+static void NeonEncodeF32(const double *src, int n, unsigned char *dst) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(src + i)),
+                                      vld1q_f64(src + i + 2));
+    vst1q_u8(dst + 4 * i, vreinterpretq_u8_f32(v));
+  }
+  ScalarEncodeF32(src + i, n - i, dst + 4 * i);
+}
+#endif  // PCM_HAVE_NEON
+
+const PcmKernels kScalarKernels = {
+    ScalarU8,  ScalarS16,  ScalarS24,   ScalarS32, ScalarF32,
+    ScalarF64, ScalarALaw, ScalarMuLaw, "scalar"};
+
+static PcmKernels SelectKernels() {
+  PcmKernels kernels = kScalarKernels;
+#if PCM_HAVE_SSE2
+  kernels = {Sse2U8,    Sse2S16,    ScalarS24,   Sse2S32, Sse2F32,
+             ScalarF64, ScalarALaw, ScalarMuLaw, "sse2"};
+#endif
+#if PCM_HAVE_AVX2
+  if (CpuHasAvx2())
+    kernels = {Avx2U8,    Avx2S16,  Avx2S24,   Avx2S32, Avx2F32,
+               ScalarF64, Avx2ALaw, Avx2MuLaw, "avx2"};
+#endif
+#if PCM_HAVE_NEON
+  kernels = {NeonU8,    NeonS16,    ScalarS24,   NeonS32, NeonF32,
+             ScalarF64, ScalarALaw, ScalarMuLaw, "neon"};
+#endif
+  return kernels;
+}
+
+const PcmEncoders kScalarEncoders = {ScalarEncodeS16, ScalarEncodeS24,
+                                     ScalarEncodeF32, "scalar"};
+
+static PcmEncoders SelectEncoders() {
+  PcmEncoders encoders = kScalarEncoders;
+#if PCM_HAVE_SSE2
+  encoders = {Sse2EncodeS16, ScalarEncodeS24, Sse2EncodeF32, "sse2"};
+#endif
+#if PCM_HAVE_AVX2
+  if (CpuHasAvx2())
+    encoders = {Avx2EncodeS16, Avx2EncodeS24, Avx2EncodeF32, "avx2"};
+#endif
+#if PCM_HAVE_NEON
+  encoders = {NeonEncodeS16, ScalarEncodeS24, NeonEncodeF32, "neon"};
+#endif
+  return encoders;
+}
+
+}  // namespace
+
+const PcmKernels *GetPcmKernels(void) {
+  static const PcmKernels kernels = SelectKernels();
+  return &kernels;
+}
+
+const PcmKernels *GetScalarPcmKernels(void) { return &kScalarKernels; }
+
+const PcmEncoders *GetPcmEncoders(void) {
+  static const PcmEncoders encoders = SelectEncoders();
+  return &encoders;
+}
+
+const PcmEncoders *GetScalarPcmEncoders(void) { return &kScalarEncoders; }
@@ -0,0 +1,424 @@
+/*
+ * @file pitchStats.cpp
+ * @brief pitch statistics over an f0 track
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "pitchStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PITCHSTATS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PITCHSTATS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+using Moments = PitchAccumulator::Moments;
+
+/*
+ * @brief combine the moments of two disjoint ranges (chan et al.)
+ */
+Moments merge(const Moments &a, const Moments &b) {
+  if (a.count == 0) return b;
+  if (b.count == 0) return a;
+  Moments r{};
+  r.count = a.count + b.count;
+  double delta = b.mean - a.mean;
+  r.mean = a.mean + delta * b.count / r.count;
+  r.m2 = a.m2 + b.m2 + delta * delta * a.count * b.count / r.count;
+  r.sum = a.sum + b.sum;
+  r.voiced = a.voiced + b.voiced;
+  r.voicedSum = a.voicedSum + b.voicedSum;
+  return r;
+}
+
+Moments scalarMoments(const double *x, int n) {
+  Moments m{};
+  for (int i = 0; i < n; i++) {
+    m.count += 1.0;
+    double delta = x[i] - m.mean;
+    m.mean += delta / m.count;
+    m.m2 += delta * (x[i] - m.mean);
+    m.sum += x[i];
+    if (x[i] != 0.0) {
+      m.voiced += 1.0;
+      m.voicedSum += x[i];
+    }
+  }
+  return m;
+}
+
+/*
+ * @brief merge 4 lanes that each saw `steps` frames, then the scalar tail
+ */
+Moments mergeLanes(const double *mean, const double *m2, const double *sum,
+                   const double *voiced, const double *voicedSum, int steps,
+                   const double *tail, int tailLength) {
+  Moments r{};
+  for (int l = 0; l < 4; l++) {
+    Moments lane{};
+    lane.count = steps;
+    lane.mean = mean[l];
+    lane.m2 = m2[l];
+    lane.sum = sum[l];
+    lane.voiced = voiced[l];
+    lane.voicedSum = voicedSum[l];
+    r = merge(r, lane);
+  }
+  return merge(r, scalarMoments(tail, tailLength));
+}
+
+#if PITCHSTATS_SSE2
+Moments rangeMoments(const double *x, int n) {
+  int steps = n / 4;
+  if (steps < 2) return scalarMoments(x, n);
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d one = _mm_set1_pd(1.0);
+  __m128d mean[2] = {zero, zero}, m2[2] = {zero, zero}, sum[2] = {zero, zero};
+  __m128d voiced[2] = {zero, zero}, voicedSum[2] = {zero, zero};
+  for (int k = 0; k < steps; k++) {
+    const __m128d inv = _mm_set1_pd(1.0 / (k + 1));
+    for (int h = 0; h < 2; h++) {
+      __m128d v = _mm_loadu_pd(x + 4 * k + 2 * h);
+      __m128d delta = _mm_sub_pd(v, mean[h]);
+      mean[h] = _mm_add_pd(mean[h], _mm_mul_pd(delta, inv));
+      m2[h] = _mm_add_pd(m2[h], _mm_mul_pd(delta, _mm_sub_pd(v, mean[h])));
+      sum[h] = _mm_add_pd(sum[h], v);
+      __m128d mask = _mm_cmpneq_pd(v, zero);
+      voiced[h] = _mm_add_pd(voiced[h], _mm_and_pd(mask, one));
+      voicedSum[h] = _mm_add_pd(voicedSum[h], _mm_and_pd(mask, v));
+    }
+  }
+  double lane[5][4];
+  for (int h = 0; h < 2; h++) {
+    _mm_storeu_pd(lane[0] + 2 * h, mean[h]);
+    _mm_storeu_pd(lane[1] + 2 * h, m2[h]);
+    _mm_storeu_pd(lane[2] + 2 * h, sum[h]);
+    _mm_storeu_pd(lane[3] + 2 * h, voiced[h]);
+    _mm_storeu_pd(lane[4] + 2 * h, voicedSum[h]);
+  }
+  return mergeLanes(lane[0], lane[1], lane[2], lane[3], lane[4], steps,
+                    x + 4 * steps, n - 4 * steps);
+}
+#elif PITCHSTATS_NEON
+Moments rangeMoments(const double *x, int n) {
+  int steps = n / 4;
+  if (steps < 2) return scalarMoments(x, n);
+  const float64x2_t zero = vdupq_n_f64(0.0);
+  const float64x2_t one = vdupq_n_f64(1.0);
+  float64x2_t mean[2] = {zero, zero}, m2[2] = {zero, zero};
+  float64x2_t sum[2] = {zero, zero};
+  float64x2_t voiced[2] = {zero, zero}, voicedSum[2] = {zero, zero};
+  for (int k = 0; k < steps; k++) {
+    const float64x2_t inv = vdupq_n_f64(1.0 / (k + 1));
+    for (int h = 0; h < 2; h++) {
+      float64x2_t v = vld1q_f64(x + 4 * k + 2 * h);
+      float64x2_t delta = vsubq_f64(v, mean[h]);
+      mean[h] = vfmaq_f64(mean[h], delta, inv);
+      m2[h] = vfmaq_f64(m2[h], delta, vsubq_f64(v, mean[h]));
+      sum[h] = vaddq_f64(sum[h], v);
+      uint64x2_t isZero = vceqq_f64(v, zero);
+      voiced[h] = vaddq_f64(voiced[h], vbslq_f64(isZero, zero, one));
+      voicedSum[h] = vaddq_f64(voicedSum[h], vbslq_f64(isZero, zero, v));
+    }
+  }
+  double lane[5][4];
+  for (int h = 0; h < 2; h++) {
+    vst1q_f64(lane[0] + 2 * h, mean[h]);
+    vst1q_f64(lane[1] + 2 * h, m2[h]);
+    vst1q_f64(lane[2] + 2 * h, sum[h]);
+    vst1q_f64(lane[3] + 2 * h, voiced[h]);
+    vst1q_f64(lane[4] + 2 * h, voicedSum[h]);
+  }
+  return mergeLanes(lane[0], lane[1], lane[2], lane[3], lane[4], steps,
+                    x + 4 * steps, n - 4 * steps);
+}
+#else
+Moments rangeMoments(const double *x, int n) {
+  int steps = n / 4;
+  if (steps < 2) return scalarMoments(x, n);
+  double mean[4]{}, m2[4]{}, sum[4]{}, voiced[4]{}, voicedSum[4]{};
+  for (int k = 0; k < steps; k++) {
+    const double inv = 1.0 / (k + 1);
+    for (int l = 0; l < 4; l++) {
+      double v = x[4 * k + l];
+      double delta = v - mean[l];
+      mean[l] += delta * inv;
+      m2[l] += delta * (v - mean[l]);
+      sum[l] += v;
+      voiced[l] += v != 0.0 ? 1.0 : 0.0;
+      voicedSum[l] += v != 0.0 ? v : 0.0;
+    }
+  }
+  return mergeLanes(mean, m2, sum, voiced, voicedSum, steps, x + 4 * steps,
+                    n - 4 * steps);
+}
+#endif
+
+}  // namespace
+
+double PitchStats::pitch2() const { return std::sqrt(variance); }
+
+double PitchStats::pitch3() const {
+  int half = frames / 2;
+  return (sum - firstHalfSum) / half - firstHalfSum / half;
+}
+
+double PitchStats::pitch4() const {
+  return last / 5.0 - headSum / std::max(frames - 5, 0);
+}
+
+PitchAccumulator::PitchAccumulator(int totalFrames) : total(totalFrames) {
+  int half = total / 2;
+  int head = std::max(total - 5, 0);
+  bound[0] = std::min(half, head);
+  bound[1] = std::max(half, head);
+}
+
+void PitchAccumulator::push(const double *f0, int count) {
+  if (count > 0) last = f0[count - 1];
+  while (count > 0) {
+    int seg = position < bound[0] ? 0 : position < bound[1] ? 1 : 2;
+    int take = seg == 2 ? count : std::min(count, bound[seg] - position);
+    segment[seg] = merge(segment[seg], rangeMoments(f0, take));
+    f0 += take;
+    count -= take;
+    position += take;
+  }
+}
+
+PitchStats PitchAccumulator::finish() const {
+  Moments all = merge(merge(segment[0], segment[1]), segment[2]);
+  double untilBound1 = segment[0].sum + segment[1].sum;
+  PitchStats ret{};
+  ret.frames = position;
+  ret.voiced = static_cast<int>(all.voiced);
+  ret.sum = all.sum;
+  ret.voicedSum = all.voicedSum;
+  ret.variance = all.count > 0 ? all.m2 / all.count : 0.0;
+  ret.firstHalfSum = total / 2 == bound[0] ? segment[0].sum : untilBound1;
+  ret.headSum =
+      std::max(total - 5, 0) == bound[0] ? segment[0].sum : untilBound1;
+  ret.last = last;
+  return ret;
+}
+
+RunningPitch::RunningPitch(int capacity) : track(capacity) {}
+
+int RunningPitch::push(const double *f0, int n) {
+  n = std::min(n, static_cast<int>(track.size()) - count);
+  if (n <= 0) return 0;
+  std::copy(f0, f0 + n, track.begin() + count);
+  all = merge(all, rangeMoments(f0, n));
+  count += n;
+  for (; half < count / 2; half++) halfSum += track[half];
+  return n;
+}
+
+PitchStats RunningPitch::stats() const {
+  PitchStats ret{};
+  ret.frames = count;
+  ret.voiced = static_cast<int>(all.voiced);
+  ret.sum = all.sum;
+  ret.voicedSum = all.voicedSum;
+  ret.variance = count > 0 ? all.m2 / all.count : 0.0;
+  ret.firstHalfSum = halfSum;
+  double tail{};
+  for (int i = std::max(count - 5, 0); i < count; i++) tail += track[i];
+  ret.headSum = all.sum - tail;
+  ret.last = count > 0 ? track[count - 1] : 0.0;
+  return ret;
+}
+
+VoicedAccumulator::VoicedAccumulator(unsigned flags,
+                                     std::vector<double> &values)
+    : flags(flags), values(values) {
+  values.clear();
+}
+
+void VoicedAccumulator::push(const double *f0, int count) {
+  if (!flags) return;
+  bool keep = flags & (SpeechStatMedian | SpeechStatPercentiles);
+  bool semitone = flags & SpeechStatSemitone;
+  bool jitter = flags & SpeechStatJitter;
+  frames += count;
+  for (int i = 0; i < count; i++) {
+    double v = f0[i];
+    if (!(v > 0.0)) {
+      previous = 0.0;
+      continue;
+    }
+    voiced++;
+    double delta = v - mean;
+    mean += delta / voiced;
+    m2 += delta * (v - mean);
+    if (semitone) {
+      double st = 12.0 * std::log2(v / 100.0);
+      double d = st - semitoneMean;
+      semitoneMean += d / voiced;
+      semitoneM2 += d * (st - semitoneMean);
+    }
+    if (jitter) {
+      periodSum += 1.0 / v;
+      if (previous > 0.0) {
+        periodChange += std::fabs(1.0 / v - 1.0 / previous);
+        pairs++;
+      }
+    }
+    if (keep) values.push_back(v);
+    previous = v;
+  }
+}
+
+VoicedStats VoicedAccumulator::finish(const double *percentiles, int count) {
+  const double nan = std::nan("");
+  VoicedStats ret{};
+  ret.flags = flags;
+  ret.frames = frames;
+  ret.voiced = voiced;
+  if (flags & SpeechStatMean) {
+    ret.mean = voiced > 0 ? mean : nan;
+    ret.sd = voiced > 0 ? std::sqrt(m2 / voiced) : nan;
+  }
+  if (flags & SpeechStatSemitone) {
+    ret.semitoneMean = voiced > 0 ? semitoneMean : nan;
+    ret.semitoneSd = voiced > 0 ? std::sqrt(semitoneM2 / voiced) : nan;
+  }
+  if (flags & SpeechStatJitter) {
+    ret.jitter = pairs > 0 ? (periodChange / pairs) / (periodSum / voiced)
+                           : nan;
+  }
+
+  //! ascending ranks, each selection only looks right of the previous one
+  double asked[SPEECH_PERCENTILES_MAX + 1];
+  int order[SPEECH_PERCENTILES_MAX + 1];
+  int n{};
+  if (flags & SpeechStatMedian) asked[n++] = 50.0;
+  if (flags & SpeechStatPercentiles) {
+    ret.percentileCount = std::min(std::max(count, 0), SPEECH_PERCENTILES_MAX);
+    for (int i = 0; i < ret.percentileCount; i++) asked[n++] = percentiles[i];
+  }
+  for (int i = 0; i < n; i++) order[i] = i;
+  std::sort(order, order + n,
+            [&asked](int a, int b) { return asked[a] < asked[b]; });
+  double found[SPEECH_PERCENTILES_MAX + 1];
+  auto from = values.begin();
+  for (int i = 0; i < n; i++) {
+    int which = order[i];
+    if (values.empty()) {
+      found[which] = nan;
+      continue;
+    }
+    double rank = std::min(std::max(asked[which], 0.0), 100.0) / 100.0 *
+                  (values.size() - 1);
+    auto k = values.begin() + static_cast<std::ptrdiff_t>(rank);
+    std::nth_element(from, k, values.end());
+    from = k;
+    double low = *k;
+    double high = low;
+    if (k + 1 != values.end()) high = *std::min_element(k + 1, values.end());
+    found[which] = low + (rank - std::floor(rank)) * (high - low);
+  }
+  int next{};
+  if (flags & SpeechStatMedian) ret.median = found[next++];
+  for (int i = 0; i < ret.percentileCount; i++) {
+    ret.percentile[i] = found[next++];
+  }
+  return ret;
+}
+
+PitchStats computePitchStats(const double *f0, int dat_length) {
+  PitchAccumulator acc(dat_length);
+  acc.push(f0, dat_length);
+  return acc.finish();
+}
+
+/*
+ * @brief getPitch1
+ * @param f0 data array
+ * @param dat_length f0 array length
+ * @return average value for f0
+ */
+double getPitch1(const double *dat, int const dat_length) {
+  double sum{};
+  for (int i = 0; i < dat_length; i++) {
+    if (dat[i] == 0.0) continue;
+    sum += dat[i];
+  }
+  return (double)sum / dat_length;
+}
+
+/*
+ * @brief getPitch2
+ * @param f0 data array
+ * @param dat_length f0 array length
+ * @return standard deviation of f0
+ */
+
+double getPitch2(const double *dat, int const dat_length) {
+  double sum{};
+  std::for_each(dat, dat + dat_length, [&sum](double each) { sum += each; });
+  double mean = (double)sum / dat_length;
+  double sd{};
+  std::for_each(dat, dat + dat_length,
+                [mean, &sd](double each) { sd += std::pow(each - mean, 2); });
+
+  return std::sqrt(sd / dat_length);
+}
+
+/*
+ * @brief getPitch3
+ * @param f0 data array
+ * @param dat_length f0 array length
+ * @return result form average of first half of f0 data minus average of last
+ * half of f0 data
+ */
+double getPitch3(const double *dat, int const dat_length) {
+  double sum1{};
+  for (int i = 0; i < dat_length / 2; i++) {
+    sum1 += dat[i];
+  }
+  sum1 /= dat_length / 2;
+
+  double sum2{};
+  for (int i = (dat_length / 2); i < dat_length; i++) {
+    sum2 += dat[i];
+  }
+  sum2 /= dat_length / 2;
+
+  return sum2 - sum1;
+}
+
+/*
+ * @brief getPitch4
+ * @param f0 data array
+ * @param dat_length f0 array length
+ * @return result from the average of f0 from index 0 to max-5 minus the average
+ * of f0 index 5 to max
+ */
+double getPitch4(const double *dat, int const dat_length) {
+  double sum1{};
+  for (int i = 0; i < dat_length - 5; i++) {
+    sum1 += dat[i];
+  }
+  sum1 /= (dat_length - 5);
+
+  double sum2{};
+  for (int i = (dat_length - 5); i < dat_length; i++) {
+    sum2 = dat[i];
+  }
+  sum2 /= 5.0;
+
+  return sum2 - sum1;
+}
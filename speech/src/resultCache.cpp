@@ -0,0 +1,396 @@
+/*
+ * @file resultCache.cpp
+ * @brief analysis results keyed by a hash of the pcm payload and options
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "resultCache.hpp"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const std::uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const std::uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const std::uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const std::uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const std::uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+std::uint64_t load64(const unsigned char *p) {
+  std::uint64_t x;
+  std::memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+std::uint64_t round64(std::uint64_t acc, std::uint64_t input) {
+  acc += input * kPrime2;
+  return rotl(acc, 31) * kPrime1;
+}
+
+std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t lane) {
+  acc ^= round64(0, lane);
+  return acc * kPrime1 + kPrime4;
+}
+
+/*
+ * @brief disk tier layout
+ * index file == DiskHeader followed by kDiskSlots DiskSlot
+ * data file == per entry the PitchStats bytes then the f0 track as doubles,
+ * written from 0 again once the next entry would end past kDiskData
+ */
+const char kDiskMagic[8] = {'S', 'P', 'C', 'A', 'C', 'H', 'E', '3'};
+const std::uint32_t kDiskSlots = 4096;
+const std::uint32_t kDiskProbe = 8;
+const std::uint64_t kDiskData = std::uint64_t(256) << 20;
+
+//! DiskSlot.used, a dropped slot is free to insert but does not end a probe
+const std::uint32_t kSlotFree = 0;
+const std::uint32_t kSlotUsed = 1;
+const std::uint32_t kSlotDropped = 2;
+
+struct DiskHeader {
+  char magic[8];
+  std::uint32_t slots;
+  std::uint32_t reserved;
+  //! end of the last complete entry, where the next one is written
+  std::uint64_t dataSize;
+};
+
+struct DiskSlot {
+  std::uint64_t pcm;
+  std::uint64_t options;
+  std::int64_t length;
+  std::uint64_t offset;
+  std::uint32_t statsSize;
+  std::uint32_t f0Count;
+  std::uint32_t used;
+  std::uint32_t reserved;
+};
+
+bool seekTo(std::FILE *f, std::uint64_t offset) {
+#if defined(_WIN32)
+  return _fseeki64(f, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+DiskHeader *header(void *map) { return static_cast<DiskHeader *>(map); }
+
+DiskSlot *slots(void *map) {
+  return reinterpret_cast<DiskSlot *>(static_cast<char *>(map) +
+                                      sizeof(DiskHeader));
+}
+
+std::uint64_t entryEnd(const DiskSlot &s) {
+  return s.offset + s.statsSize + std::uint64_t{s.f0Count} * sizeof(double);
+}
+
+}  // namespace
+
+std::uint64_t hashBytes(const void *data, std::size_t size,
+                        std::uint64_t seed) {
+  auto *p = static_cast<const unsigned char *>(data);
+  const unsigned char *end = p + size;
+  std::uint64_t h;
+  if (size >= 32) {
+    std::uint64_t v1 = seed + kPrime1 + kPrime2;
+    std::uint64_t v2 = seed + kPrime2;
+    std::uint64_t v3 = seed;
+    std::uint64_t v4 = seed - kPrime1;
+    for (; p + 32 <= end; p += 32) {
+      v1 = round64(v1, load64(p));
+      v2 = round64(v2, load64(p + 8));
+      v3 = round64(v3, load64(p + 16));
+      v4 = round64(v4, load64(p + 24));
+    }
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = mergeRound(h, v1);
+    h = mergeRound(h, v2);
+    h = mergeRound(h, v3);
+    h = mergeRound(h, v4);
+  } else {
+    h = seed + kPrime5;
+  }
+  h += static_cast<std::uint64_t>(size);
+  for (; p + 8 <= end; p += 8) {
+    h ^= round64(0, load64(p));
+    h = rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  for (; p < end; p++) {
+    h ^= *p * kPrime5;
+    h = rotl(h, 11) * kPrime1;
+  }
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+ResultCache::~ResultCache() { closeDisk(); }
+
+ResultCache &ResultCache::shared() {
+  static ResultCache *cache = new ResultCache();
+  return *cache;
+}
+
+ResultCache::DiskState ResultCache::configure(std::size_t entries,
+                                              const char *directory) {
+  std::lock_guard<std::mutex> lk(lock);
+  lru.clear();
+  index.clear();
+  closeDisk();
+  capacity = entries;
+  if (capacity == 0 || !directory || !*directory) return DiskReady;
+  return openDisk(directory);
+}
+
+bool ResultCache::find(const CacheKey &key, PitchStats &stats,
+                       std::vector<double> &f0) {
+  std::lock_guard<std::mutex> lk(lock);
+  if (capacity == 0) return false;
+  auto it = index.find(key);
+  if (it != index.end()) {
+    lru.splice(lru.begin(), lru, it->second);
+    stats = it->second->second.stats;
+    f0 = it->second->second.f0;
+    return true;
+  }
+  Entry entry{};
+  if (!diskFind(key, entry)) return false;
+  stats = entry.stats;
+  f0 = entry.f0;
+  remember(key, std::move(entry));
+  return true;
+}
+
+void ResultCache::insert(const CacheKey &key, const PitchStats &stats,
+                         const std::vector<double> &f0) {
+  std::lock_guard<std::mutex> lk(lock);
+  if (capacity == 0) return;
+  Entry entry{stats, f0};
+  diskInsert(key, entry);
+  remember(key, std::move(entry));
+}
+
+void ResultCache::remember(const CacheKey &key, Entry entry) {
+  auto it = index.find(key);
+  if (it != index.end()) {
+    it->second->second = std::move(entry);
+    lru.splice(lru.begin(), lru, it->second);
+    return;
+  }
+  lru.emplace_front(key, std::move(entry));
+  index[key] = lru.begin();
+  while (lru.size() > capacity) {
+    index.erase(lru.back().first);
+    lru.pop_back();
+  }
+}
+
+/*
+ * @brief lock and map the index file, a missing or foreign index is recreated
+ * empty together with its data file. the lock is taken before anything is
+ * read, another process holding it leaves both files alone.
+ */
+ResultCache::DiskState ResultCache::openDisk(const std::string &directory) {
+  std::string indexPath = directory + "/speech-cache.idx";
+  std::string dataPath = directory + "/speech-cache.dat";
+  indexSize = sizeof(DiskHeader) + sizeof(DiskSlot) * kDiskSlots;
+
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(indexPath.c_str(), GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return DiskFailed;
+  //! a byte past any real data, so the lock only excludes other caches
+  OVERLAPPED at{};
+  at.OffsetHigh = MAXDWORD;
+  if (!LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0,
+                  1, 0, &at)) {
+    CloseHandle(file);
+    return DiskLocked;
+  }
+  LARGE_INTEGER size{};
+  GetFileSizeEx(file, &size);
+  bool fresh = static_cast<std::size_t>(size.QuadPart) != indexSize;
+  if (fresh) {
+    LARGE_INTEGER want{};
+    want.QuadPart = static_cast<LONGLONG>(indexSize);
+    SetFilePointerEx(file, want, NULL, FILE_BEGIN);
+    SetEndOfFile(file);
+  }
+  HANDLE mapping =
+      CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, 0, NULL);
+  if (!mapping) {
+    CloseHandle(file);
+    return DiskFailed;
+  }
+  void *map = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, indexSize);
+  if (!map) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return DiskFailed;
+  }
+  indexFile = file;
+  indexMapping = mapping;
+#else
+  int fd = open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return DiskFailed;
+  //! released by close, also when the process dies
+  if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    close(fd);
+    return DiskLocked;
+  }
+  struct stat st {};
+  fstat(fd, &st);
+  bool fresh = static_cast<std::size_t>(st.st_size) != indexSize;
+  if (fresh && ftruncate(fd, 0) != 0) {
+    close(fd);
+    return DiskFailed;
+  }
+  if (fresh && ftruncate(fd, static_cast<off_t>(indexSize)) != 0) {
+    close(fd);
+    return DiskFailed;
+  }
+  void *map =
+      mmap(NULL, indexSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return DiskFailed;
+  }
+  indexFile = fd;
+#endif
+  indexMap = map;
+
+  fresh = fresh || std::memcmp(header(map)->magic, kDiskMagic, 8) != 0 ||
+          header(map)->slots != kDiskSlots;
+  data = fresh ? nullptr : std::fopen(dataPath.c_str(), "r+b");
+  if (!data) {
+    fresh = true;
+    data = std::fopen(dataPath.c_str(), "w+b");
+  }
+  if (!data) {
+    closeDisk();
+    return DiskFailed;
+  }
+  if (fresh) {
+    std::memset(map, 0, indexSize);
+    std::memcpy(header(map)->magic, kDiskMagic, 8);
+    header(map)->slots = kDiskSlots;
+  }
+  return DiskReady;
+}
+
+void ResultCache::closeDisk() {
+  if (data) std::fclose(data);
+  data = nullptr;
+  if (!indexMap) return;
+#if defined(_WIN32)
+  UnmapViewOfFile(indexMap);
+  CloseHandle(indexMapping);
+  CloseHandle(indexFile);
+  indexMapping = nullptr;
+  indexFile = nullptr;
+#else
+  munmap(indexMap, indexSize);
+  close(indexFile);
+  indexFile = -1;
+#endif
+  indexMap = nullptr;
+}
+
+bool ResultCache::diskFind(const CacheKey &key, Entry &entry) {
+  if (!indexMap) return false;
+  DiskSlot *table = slots(indexMap);
+  for (std::uint32_t i = 0; i < kDiskProbe; i++) {
+    const DiskSlot &s = table[(key.pcm + i) % kDiskSlots];
+    if (s.used == kSlotFree) return false;
+    if (s.used != kSlotUsed || s.pcm != key.pcm || s.options != key.options ||
+        s.length != key.length) {
+      continue;
+    }
+    if (s.statsSize != sizeof(PitchStats) || entryEnd(s) > kDiskData) {
+      return false;
+    }
+    entry.f0.resize(s.f0Count);
+    return seekTo(data, s.offset) &&
+           std::fread(&entry.stats, sizeof(PitchStats), 1, data) == 1 &&
+           std::fread(entry.f0.data(), sizeof(double), s.f0Count, data) ==
+               s.f0Count;
+  }
+  return false;
+}
+
+/*
+ * @brief write the entry after the last one, or from 0 when it would end past
+ * kDiskData, and point a slot at it. the entries it overwrites are dropped
+ * first. the slot is the matching one along the probe sequence, otherwise
+ * the first free or dropped one, the home slot when the sequence is full.
+ */
+void ResultCache::diskInsert(const CacheKey &key, const Entry &entry) {
+  if (!indexMap) return;
+  std::uint64_t size = sizeof(PitchStats) + entry.f0.size() * sizeof(double);
+  if (size > kDiskData) return;
+  std::uint64_t offset = header(indexMap)->dataSize;
+  if (offset + size > kDiskData) offset = 0;
+
+  DiskSlot *table = slots(indexMap);
+  for (std::uint32_t i = 0; i < kDiskSlots; i++) {
+    DiskSlot &s = table[i];
+    if (s.used == kSlotUsed && s.offset < offset + size &&
+        entryEnd(s) > offset) {
+      s.used = kSlotDropped;
+    }
+  }
+  DiskSlot *slot{};
+  for (std::uint32_t i = 0; i < kDiskProbe; i++) {
+    DiskSlot &s = table[(key.pcm + i) % kDiskSlots];
+    if (s.used == kSlotUsed) {
+      if (s.pcm == key.pcm && s.options == key.options &&
+          s.length == key.length) {
+        slot = &s;
+        break;
+      }
+      continue;
+    }
+    if (!slot) slot = &s;
+    if (s.used == kSlotFree) break;
+  }
+  if (!slot) slot = &table[key.pcm % kDiskSlots];
+
+  if (!seekTo(data, offset) ||
+      std::fwrite(&entry.stats, sizeof(PitchStats), 1, data) != 1 ||
+      std::fwrite(entry.f0.data(), sizeof(double), entry.f0.size(), data) !=
+          entry.f0.size() ||
+      std::fflush(data) != 0) {
+    return;
+  }
+
+  slot->used = kSlotDropped;
+  slot->pcm = key.pcm;
+  slot->options = key.options;
+  slot->length = key.length;
+  slot->offset = offset;
+  slot->statsSize = static_cast<std::uint32_t>(sizeof(PitchStats));
+  slot->f0Count = static_cast<std::uint32_t>(entry.f0.size());
+  slot->used = kSlotUsed;
+  header(indexMap)->dataSize = offset + size;
+}
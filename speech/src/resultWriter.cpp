@@ -0,0 +1,193 @@
+/*
+ * @file resultWriter.cpp
+ * @brief analysis result record and its allocation free json serializer
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "resultWriter.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+#include "nlohmann/json.hpp"
+
+namespace {
+
+/*
+ * @brief appends to a fixed buffer, keeps counting once it is full so the
+ * caller learns the size it needs
+ */
+struct Writer {
+  char *dst;
+  std::size_t capacity;
+  std::size_t size{};
+
+  void put(char c) {
+    if (size + 1 < capacity) dst[size] = c;
+    size++;
+  }
+  void put(const char *s) {
+    while (*s) put(*s++);
+  }
+
+  void putString(const char *s) {
+    put('"');
+    for (; *s; s++) {
+      char c = *s;
+      if (c == '"' || c == '\\') put('\\');
+      //! comments are ours, a control character can only come from a
+      //! foreign exception text
+      put(static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+    }
+    put('"');
+  }
+
+  /*
+   * @brief the digits nlohmann::json prints, its grisu2 conversion is used
+   * directly. it does not allocate and unlike printf ignores the locale.
+   */
+  void putDouble(double v) {
+    if (!std::isfinite(v)) {
+      put("null");
+      return;
+    }
+    char tmp[64];
+    char *end = nlohmann::detail::to_chars(tmp, tmp + sizeof(tmp), v);
+    for (char *c = tmp; c != end; c++) put(*c);
+  }
+
+  void putInt(long long v) {
+    char tmp[24];
+    std::snprintf(tmp, sizeof(tmp), "%lld", v);
+    put(tmp);
+  }
+
+  void key(const char *name) {
+    putString(name);
+    put(':');
+  }
+
+  //! comment, pitch1 .. pitch4 and status, without the braces
+  void putResult(const AnalysisResult &result) {
+    key("comment");
+    putString(result.comment);
+    const char *pitchKey[4] = {"pitch1", "pitch2", "pitch3", "pitch4"};
+    for (int i = 0; i < 4; i++) {
+      put(',');
+      key(pitchKey[i]);
+      putDouble(result.pitch[i]);
+    }
+    put(',');
+    key("status");
+    putInt(result.status);
+  }
+
+  //! the voiced object with a leading comma, nothing when none was computed
+  void putVoiced(const VoicedStats &v) {
+    if (!v.flags) return;
+    put(",\"voiced\":{");
+    if (v.flags & SpeechStatJitter) {
+      key("jitter");
+      putDouble(v.jitter);
+      put(',');
+    }
+    if (v.flags & SpeechStatMean) {
+      key("mean_hz");
+      putDouble(v.mean);
+      put(',');
+    }
+    if (v.flags & SpeechStatMedian) {
+      key("median_hz");
+      putDouble(v.median);
+      put(',');
+    }
+    if (v.flags & SpeechStatPercentiles) {
+      key("percentiles_hz");
+      put('[');
+      for (int i = 0; i < v.percentileCount; i++) {
+        if (i) put(',');
+        putDouble(v.percentile[i]);
+      }
+      put("],");
+    }
+    key("ratio");
+    putDouble(v.ratio());
+    if (v.flags & SpeechStatMean) {
+      put(',');
+      key("sd_hz");
+      putDouble(v.sd);
+    }
+    if (v.flags & SpeechStatSemitone) {
+      put(',');
+      key("semitone_mean");
+      putDouble(v.semitoneMean);
+      put(',');
+      key("semitone_sd");
+      putDouble(v.semitoneSd);
+    }
+    put('}');
+  }
+};
+
+}  // namespace
+
+void AnalysisResult::setStatus(int code, const char *text,
+                               const char *detail) {
+  status = code;
+  std::snprintf(comment, sizeof(comment), "%s%s", text, detail ? detail : "");
+}
+
+void AnalysisResult::setPitch(const PitchStats &from) {
+  stats = from;
+  pitch[0] = from.pitch1();
+  pitch[1] = from.pitch2();
+  pitch[2] = from.pitch3();
+  pitch[3] = from.pitch4();
+}
+
+std::size_t writeResultJson(const AnalysisResult &result,
+                            const AnalysisResult *channels, int channelCount,
+                            const StageClock *timings, char *dst,
+                            std::size_t capacity) {
+  Writer w{dst, capacity};
+  w.put('{');
+  if (channels) {
+    w.key("channels");
+    w.put('[');
+    for (int c = 0; c < channelCount; c++) {
+      w.put(c ? ",{" : "{");
+      w.putResult(channels[c]);
+      w.putVoiced(channels[c].voiced);
+      w.put('}');
+    }
+    w.put("],");
+  }
+  w.putResult(result);
+  if (timings) {
+    //! sorted by key name
+    const Stage order[] = {StageCache,     StageDecode, StageF0, StageOpen,
+                           StageSerialize, StageStats,  StageVad};
+    w.put(",\"timings\":{");
+    bool first = true;
+    for (auto stage : order) {
+      if (timings->nanos[stage] < 0) continue;
+      if (!first) w.put(',');
+      first = false;
+      w.put('"');
+      w.put(stageName(stage));
+      w.put("_ms\":");
+      w.putDouble(timings->ms(stage));
+    }
+    w.put('}');
+  }
+  w.putVoiced(result.voiced);
+  w.put('}');
+
+  std::size_t required = w.size + 1;
+  if (capacity == 0) return required;
+  dst[required <= capacity ? w.size : 0] = '\0';
+  return required;
+}
@@ -1,350 +1,1319 @@
-/*
- * @file speech.cpp
- * @author suka isnaini (kenzanin)
- * @date 26-08-21
- * @brief code for getting f0 from libworld (high quality speech analysis)
- *
-Authored by Suka Isnaini on 9th of August 2021
-Created for PT Sejahtera Empati Pratama
-All Copyrights belong to PT Sejahtera Empati Pratama
-*/
-
-#include "speech.hpp"
-
-#include <algorithm>
-#include <array>
-#include <cmath>
-#include <cstdio>
-#include <cstring>
-#include <future>
-#include <iostream>
-#include <thread>
-#include <utility>
-#include <vector>
-
-#include "audioio.h"
-#include "jsonString.hpp"
-#include "world/cheaptrick.h"
-#include "world/constantnumbers.h"
-#include "world/dio.h"
-#include "world/harvest.h"
-#include "world/stonemask.h"
-
-/*
- * @brief this macro controll f0 capture method 1 for harvest and 0 for dio,
- * more detail about harvest or dio can be found in the world doc
- * @param 1 == harvest
- * @param 0 == dio
- */
-#define __HARVEST__ 1
-
-/*
- * @brief error definition
- *
- */
-static const std::map<int, std::string> errCode{
-    {0000, "success"},
-    {1000, "Error : file not found"},
-    {1001, "Error : file cannot be read"},
-    {1002, "Error : file is not on correct format"},
-    {2000, "Error : no speech detected"},
-    {2001, "Error : cannot calculate pitch 1. Reason : ..."},
-    {2002, "Error : cannot calculate pitch 2. Reason : ..."},
-    {2003, "Error : cannot calculate pitch 3. Reason : ..."},
-    {2004, "Error : cannot calculate pitch 4. Reason : ..."},
-    {3000, "Error : Memory Allocation Error"}};
-
-/*
- * @brief _wavFile struct
- * @detail this struct hold wav related data such as
- * - fileName == wav filename in c string
- * - fs == needed by worldlib
- * - nbit == needed by worldlib
- * - length == needed by worldlib
- * default constructor with parameter wav file location and file name in c
- * string.
- */
-
-struct _wavFile {
- public:
-  const char *fileName{};
-  int fs{};
-  int nbit{};
-  int length{};
-  const double *buf{};
-  ~_wavFile() { delete[] buf; }
-  _wavFile(const char *file = {}) : fileName(file) {
-    try {
-      length = GetAudioLength(fileName);
-      if (length == 0 || length == -1) {
-        throw 1002;
-      }
-    } catch (int e) {
-      jsonResult.at("status") = e;
-      jsonResult.at("comment") = errCode.at(1002);
-      std::cerr << 1002 << " " << errCode.at(1002) << "\n";
-      throw;
-    }
-
-    try {
-      buf = new const double[length]{};
-    } catch (std::bad_alloc &e) {
-      std::cerr << 3000 << " " << errCode.at(3000) << " " << e.what() << "\n";
-
-      jsonResult.at("status") = 3000;
-      jsonResult.at("comment") = errCode.at(3000) + e.what();
-      throw 3000;
-    }
-    wavread(fileName, &fs, &nbit, const_cast<double *>(buf));
-  }
-
-  //! linter be quiet!
-  //_wavFile(_wavFile const &other){};
-  //_wavFile operator=(_wavFile const &other) { return *this; }
-};
-
-/*
- * @brief _f0 struct
- * @detail
- * this struct provide space to hold f0 data, generate by worldlib such as
- * - f0 array of double
- * - temporalPossition array of double
- * default constructor with parameter the size of array in int
- */
-struct _f0 {
-  double *f0{};
-  double *temporalPossition{};
-  int numOfFrame{};
-  _f0(int in = {}) : numOfFrame(in) {
-    try {
-      f0 = new double[numOfFrame]{};
-      temporalPossition = new double[numOfFrame]{};
-    } catch (std::bad_alloc &e) {
-      std::cerr << 3000 << " " << errCode.at(3000) << " " << e.what() << "\n";
-
-      jsonResult.at("status") = 3000;
-      jsonResult.at("comment") = errCode.at(3000) + e.what();
-      throw 3000;
-    }
-  }
-  ~_f0() {
-    delete[] f0;
-    delete[] temporalPossition;
-  };
-
-  //! linter be quiet!
-  //_f0(const _f0 &other) {}
-  //_f0 operator=(const _f0 &other) { return *this; }
-};
-
-/*
- * @brief getPitch1
- * @param f0 data array
- * @param dat_length f0 array length
- * @return average value for f0
- */
-double getPitch1(const double *dat, int const dat_length) {
-  double sum{};
-  for (int i = 0; i < dat_length; i++) {
-    if (dat[i] == 0.0) continue;
-    sum += dat[i];
-  }
-  return (double)sum / dat_length;
-}
-
-/*
- * @brief getPitch2
- * @param f0 data array
- * @param dat_length f0 array length
- * @return standard deviation of f0
- */
-
-double getPitch2(const double *dat, int const dat_length) {
-  double sum{};
-  std::for_each(dat, dat + dat_length, [&sum](double each) { sum += each; });
-  double mean = (double)sum / dat_length;
-  double sd{};
-  std::for_each(dat, dat + dat_length,
-                [mean, &sd](double each) { sd += std::pow(each - mean, 2); });
-
-  return std::sqrt(sd / dat_length);
-}
-
-/*
- * @brief getPitch3
- * @param f0 data array
- * @param dat_length f0 array length
- * @return result form average of first half of f0 data minus average of last
- * half of f0 data
- */
-double getPitch3(const double *dat, int const dat_length) {
-  double sum1{};
-  for (int i = 0; i < dat_length / 2; i++) {
-    sum1 += dat[i];
-  }
-  sum1 /= dat_length / 2;
-
-  double sum2{};
-  for (int i = (dat_length / 2); i < dat_length; i++) {
-    sum2 += dat[i];
-  }
-  sum2 /= dat_length / 2;
-
-  return sum2 - sum1;
-}
-
-/*
- * @brief getPitch4
- * @param f0 data array
- * @param dat_length f0 array length
- * @return result from the average of f0 from index 0 to max-5 minus the average
- * of f0 index 5 to max
- */
-double getPitch4(const double *dat, int const dat_length) {
-  double sum1{};
-  for (int i = 0; i < dat_length - 5; i++) {
-    sum1 += dat[i];
-  }
-  sum1 /= (dat_length - 5);
-
-  double sum2{};
-  for (int i = (dat_length - 5); i < dat_length; i++) {
-    sum2 = dat[i];
-  }
-  sum2 /= 5.0;
-
-  return sum2 - sum1;
-}
-
-/* @brief the main function of this module
- * @param filename == wav file path in c string type
- * @return 0
- * @detail this function feed the necessary data extracted from wav file to lib
- * world to get the f0 data and to be processed by getPitch1,2,3,4.
- */
-
-int __PitchAnalyzer(const char *fileName) {
-  {
-    std::FILE *file;
-    try {
-      errno_t err = fopen_s(&file, fileName, "r");
-      if (err) throw 1000;
-    } catch (int e) {
-      std::cerr << errCode.at(e) << "\n";
-      jsonResult.at("status") = e;
-      jsonResult.at("comment") = errCode.at(e);
-      return 1000;
-    }
-    std::fclose(file);
-  }
-
-  _wavFile *wav{};
-  try {
-    wav = new _wavFile(fileName);
-  } catch (int e) {
-    return e;
-  }
-
-#if __DEBUG__ == 1
-  std::printf("\n\nSTART: list dari buf wav\n\n");
-  for (int i = 0; i < wav->length; i++) {
-    std::printf(" %.2f ", wav->buf[i]);
-  }
-  std::printf("\n\nEND: list dari buf wav\n\n");
-#endif
-
-#if __HARVEST__ == 1
-  HarvestOption option{};
-  InitializeHarvestOption(&option);
-#else
-  DioOption option{};
-  InitializeDioOption(&option);
-#endif
-
-  _f0 *f0{};
-  try {
-#if __HARVEST__ == 1
-    f0 = new _f0(
-        GetSamplesForHarvest(wav->fs, wav->length, option.frame_period));
-#else
-    f0 = new _f0(GetSamplesForDIO(wav->fs, wav->length, option.frame_period));
-#endif
-  } catch (int e) {
-    delete f0;
-    return e;
-  }
-
-#if __HARVEST__ == 1
-  Harvest(wav->buf, wav->length, wav->fs, &option, f0->temporalPossition,
-          f0->f0);
-#else
-  Dio(wav->buf, wav->length, wav->fs, &option, f0->temporalPossition, f0->f0);
-#endif
-
-#if __DEBUG__ == 1
-  std::printf("\n\nSTART: list dari F0:\n\n");
-  for (int i = 0; i < f0->numOfFrame; i++) {
-    std::printf(" %.2f ", f0->f0[i]);
-  }
-  std::printf("\n\nEND: list dari F0:\n\n");
-#endif
-  //! start getPitch1,2,3,4 asnyc or threaded
-  std::future<double> ret1 = std::async(&getPitch1, f0->f0, f0->numOfFrame);
-  std::future<double> ret2 = std::async(&getPitch2, f0->f0, f0->numOfFrame);
-  std::future<double> ret3 = std::async(&getPitch3, f0->f0, f0->numOfFrame);
-  std::future<double> ret4 = std::async(&getPitch4, f0->f0, f0->numOfFrame);
-
-  //! wait until async process finish and return the result
-  jsonResult.at("pitch1") = ret1.get();
-  jsonResult.at("pitch2") = ret2.get();
-  jsonResult.at("pitch3") = ret3.get();
-  jsonResult.at("pitch4") = ret4.get();
-  jsonResult.at("comment") = errCode.at(0);
-
-  delete f0;
-  delete wav;
-  return {};
-}
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/*
- * @brief PitchAnalyzer
- * @param fileName == wav file name in c string
- * @param dst == pointer of string to store the c string result, the caller need
- * to allocated this first and then free it.
- * @return 0 == succes, non zero err in error
- */
-DLLEXPORT int ADDCALL PitchAnalyzer(char *const fileName, char *const dst) {
-//! macro to remove function decoration in the library if using msvc compiler
-#if defined(_MSC_VER) && !defined(__clang__)
-  __pragma(comment(linker, "/export:PitchAnalyzer=_PitchAnalyzer@8"));
-#endif
-  auto err = __PitchAnalyzer(fileName);
-  auto x = jsonResult.dump();
-  x.copy(dst, x.length() + 1, 0);
-  return err == 0 ? 0 : err;
-}
-
-/*
- * @brief PitchAnalyzer2
- * @param fileName == wav file name in c string
- * @return pointer of c string result.
- */
-DLLEXPORT char *ADDCALL PitchAnalyzer2(char const *fileName) {
-//! macro to remove function decoration in the library if using msvc compiler
-#if defined(_MSC_VER) && !defined(__clang__)
-  __pragma(comment(linker, "/export:PitchAnalyzer2=_PitchAnalyzer2@4"));
-#endif
-  __PitchAnalyzer(fileName);
-  auto x = jsonResult.dump();
-  char *json_return = new char[x.length() + 1]{};
-  x.copy(json_return, x.length(), 0);
-  return json_return;
-}
-
-#ifdef __cplusplus
-}
-#endif
+/*
+ * @file speech.cpp
+ * @author suka isnaini (kenzanin)
+ * @date 26-08-21
+ * @brief code for getting f0 from libworld (high quality speech analysis)
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "speech.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+#include "audioio.h"
+#include "f0Estimator.hpp"
+#include "nlohmann/json.hpp"
+#include "pitchStats.hpp"
+#include "resultCache.hpp"
+#include "resultWriter.hpp"
+#include "stageTimer.hpp"
+#include "threadPool.hpp"
+#include "voiceActivity.hpp"
+
+/*
+ * @brief error definition
+ *
+ */
+static const std::map<int, std::string> errCode{
+    {0000, "success"},
+    {1000, "Error : file not found"},
+    {1001, "Error : file cannot be read"},
+    {1002, "Error : file is not on correct format"},
+    {1003, "Error : invalid analysis options"},
+    {1004, "Error : stream capacity exceeded"},
+    {1005, "Error : cache directory is used by another process"},
+    {2000, "Error : no speech detected"},
+    {2001, "Error : cannot calculate pitch 1. Reason : ..."},
+    {2002, "Error : cannot calculate pitch 2. Reason : ..."},
+    {2003, "Error : cannot calculate pitch 3. Reason : ..."},
+    {2004, "Error : cannot calculate pitch 4. Reason : ..."},
+    {2005, "Error : some channels cannot be analyzed, see channels"},
+    {3000, "Error : Memory Allocation Error"}};
+
+/*
+ * @brief _wavFile struct
+ * @detail this struct hold wav related data such as
+ * - fileName == wav filename in c string, nullptr for memory sources
+ * - fs == needed by worldlib
+ * - nbit == needed by worldlib
+ * - length == needed by worldlib
+ * - buf == the whole signal once loaded, in the arena or the caller's
+ * - map == the mapped file or in memory pcm, kept so blocks can be decoded on
+ * demand
+ * - channel == the channel of map this source reads, 0 for mono
+ * constructors take the result to report errors into and one source:
+ * - wav file location and file name in c string, the file is mapped
+ * - a parsed WavFile whose payload is already in memory
+ * - one channel of a WavFile opened by another source, which keeps the
+ * mapping
+ * - a double signal owned by the caller, used in place
+ * the pcm sources are only decoded by load() or block by block. the struct
+ * itself is placed in the arena of the context.
+ */
+
+struct _wavFile {
+ public:
+  const char *fileName{};
+  int fs{};
+  int nbit{};
+  std::int64_t length{};
+  const double *buf{};
+  WavFile map{};
+  int channel{};
+  ~_wavFile() { wavclose(&map); }
+  _wavFile(AnalysisResult &result, const char *file = {}) : fileName(file) {
+    //! map the file once, the header is parsed here and reused for decoding
+    try {
+      auto err = wavopen(fileName, &map);
+      if (err == 0) {
+        throw 1000;
+      }
+      if (err == -1 || map.length == 0) {
+        wavclose(&map);
+        throw 1002;
+      }
+    } catch (int e) {
+      fail(result, e);
+    }
+    fs = map.fs;
+    nbit = map.nbit;
+    length = map.length;
+  }
+
+  _wavFile(AnalysisResult &result, const WavFile &pcm) : map(pcm) {
+    if (map.length <= 0 || map.fs <= 0) fail(result, 1002);
+    fs = map.fs;
+    nbit = map.nbit;
+    length = map.length;
+  }
+
+  _wavFile(AnalysisResult &, const WavFile &pcm, int index)
+      : map(pcm), channel(index) {
+    //! the mapping is closed by the source it was borrowed from
+    map.base = nullptr;
+    map.size = 0;
+    fs = map.fs;
+    nbit = map.nbit;
+    length = map.length;
+  }
+
+  _wavFile(AnalysisResult &result, const double *samples, int n, int rate)
+      : fs(rate), length(n), buf(samples) {
+    if (!samples || n <= 0 || rate <= 0) fail(result, 1002);
+  }
+
+  [[noreturn]] static void fail(AnalysisResult &result, int e) {
+    result.setStatus(e, errCode.at(e).c_str());
+    std::cerr << e << " " << errCode.at(e) << "\n";
+    throw e;
+  }
+
+  void load(AnalysisResult &result, Arena &arena) {
+    if (buf) return;
+    try {
+      buf = arena.take<double>(length);
+    } catch (std::bad_alloc &e) {
+      std::cerr << 3000 << " " << errCode.at(3000) << " " << e.what() << "\n";
+
+      result.setStatus(3000, errCode.at(3000).c_str(), e.what());
+      throw 3000;
+    }
+    wavdecode(&map, const_cast<double *>(buf));
+    wavclose(&map);
+  }
+
+  //! linter be quiet!
+  //_wavFile(_wavFile const &other){};
+  //_wavFile operator=(_wavFile const &other) { return *this; }
+};
+
+/*
+ * @brief _f0 struct
+ * @detail
+ * this struct provide space to hold f0 data, generate by worldlib such as
+ * - f0 array of double
+ * - temporalPossition array of double
+ * default constructor with parameter the result to report errors into, the
+ * arena the arrays are taken from and the size of array in int
+ */
+struct _f0 {
+  double *f0{};
+  double *temporalPossition{};
+  int numOfFrame{};
+  _f0(AnalysisResult &result, Arena &arena, int in = {}) : numOfFrame(in) {
+    try {
+      f0 = arena.take<double>(numOfFrame);
+      temporalPossition = arena.take<double>(numOfFrame);
+    } catch (std::bad_alloc &e) {
+      std::cerr << 3000 << " " << errCode.at(3000) << " " << e.what() << "\n";
+
+      result.setStatus(3000, errCode.at(3000).c_str(), e.what());
+      throw 3000;
+    }
+    std::fill(f0, f0 + numOfFrame, 0.0);
+    std::fill(temporalPossition, temporalPossition + numOfFrame, 0.0);
+  }
+
+  //! linter be quiet!
+  //_f0(const _f0 &other) {}
+  //_f0 operator=(const _f0 &other) { return *this; }
+};
+
+/*
+ * @brief SpeechContext struct
+ * @detail one analysis handle, everything an analysis writes lives here so
+ * N contexts can run in parallel without locks
+ * - options == estimator and its parameters
+ * - result == result of the last analysis
+ * - resultText == json of result handed out to the caller, serialized on
+ * first use and grown when the channels do not fit
+ * - resultSize == bytes used in resultText, 0 until serialized
+ * - f0 == f0 track of the last analysis, empty in block mode
+ * - clock == time spent per stage by the last analysis
+ * - cacheHit == the last result came from the result cache
+ * - arena == signal and f0 buffers, reset at the start of every analysis
+ * - scratch == estimator buffers, kept at their largest size
+ * - segments == estimator buffers of the segments run at once with
+ * options.parallel
+ * - vad == voice activity buffers and the speech regions of the last analysis
+ * - channels == one context per channel of a multichannel file, kept with
+ * their buffers. result and f0 then repeat a channel, see analyzeChannels
+ * - channelResults == results of the channels, empty for a mono source
+ * - voicedValues == voiced f0 kept for the median and percentiles
+ */
+struct SpeechContext {
+  SpeechOptions options = defaultOptions();
+  AnalysisResult result{};
+  std::vector<char> resultText = std::vector<char>(SPEECH_RESULT_MAX);
+  std::size_t resultSize{};
+  std::vector<double> f0{};
+  StageClock clock{};
+  bool cacheHit{};
+  Arena arena{};
+  F0Scratch scratch{};
+  std::vector<F0Scratch> segments{};
+  VadScratch vad{};
+  std::vector<std::unique_ptr<SpeechContext>> channels{};
+  std::vector<AnalysisResult> channelResults{};
+  std::vector<double> voicedValues{};
+
+  static SpeechOptions defaultOptions() {
+    SpeechOptions ret{};
+    initializeF0Options(&ret);
+    return ret;
+  }
+};
+
+/*
+ * @brief longest signal analyzed in one piece, 2^27 samples or 1 GB of
+ * doubles. world takes int lengths and harvest works on several copies of its
+ * input, so a longer signal is always analyzed block by block.
+ */
+static const std::int64_t kMaxWholeSamples = std::int64_t(1) << 27;
+
+/*
+ * @brief block length in seconds when the block mode is forced
+ */
+static const double kLongBlockLength = 60.0;
+
+/*
+ * @brief the options a signal of length samples at fs is analyzed with, the
+ * given ones with the block mode forced when it is too long for one piece
+ */
+static SpeechOptions effectiveOptions(const SpeechOptions &option, int fs,
+                                      std::int64_t length) {
+  SpeechOptions ret = option;
+  if (length > kMaxWholeSamples) {
+    double longest = static_cast<double>(kMaxWholeSamples) / fs;
+    double block = option.block_length > 0.0 ? option.block_length
+                                             : kLongBlockLength;
+    ret.block_length = std::min(block, longest);
+  }
+  return ret;
+}
+
+/*
+ * @brief a signal of length samples is analyzed block by block
+ */
+static bool blockMode(const SpeechOptions &option, int fs,
+                      std::int64_t length) {
+  return option.block_length > 0.0 && length > option.block_length * fs;
+}
+
+/*
+ * @brief samples of wav, from the loaded signal or decoded from the source
+ */
+static void readSamples(const _wavFile &wav, std::int64_t start, int count,
+                        double *x) {
+  if (wav.buf) {
+    std::copy(wav.buf + start, wav.buf + start + count, x);
+  } else {
+    wavdecodechannel(&wav.map, wav.channel, start, count, x);
+  }
+}
+
+/*
+ * @brief blockPitchStats
+ * @param option == analysis options, block_length set
+ * @param wav == source, not loaded
+ * @param regions == frames to estimate, the others are unvoiced
+ * @param scratch == block buffers, kept by the context between analyses
+ * @param voiced == receive the f0 frames too
+ * @param clock == receive the decode, f0 and stats time
+ * @return pitch statistics accumulated block by block
+ * @detail the source is decoded and analyzed one block at a time, neither the
+ * samples nor the f0 track of the whole file are ever held in memory.
+ */
+static PitchStats blockPitchStats(const SpeechOptions &option,
+                                  const _wavFile &wav,
+                                  const std::vector<FrameRange> &regions,
+                                  F0Scratch &scratch, VoicedAccumulator &voiced,
+                                  StageClock &clock) {
+  auto start = std::chrono::steady_clock::now();
+  StageClock inner{};
+  PitchAccumulator acc(getSamplesForF0(option, wav.fs, wav.length));
+  estimateF0Regions(
+      option, wav.fs, wav.length, regions,
+      [&wav, &inner](std::int64_t start, int count, double *x) {
+        StageTimer timer(inner, StageDecode);
+        readSamples(wav, start, count, x);
+      },
+      [&acc, &voiced, &inner](const double *f0, int count) {
+        StageTimer timer(inner, StageStats);
+        acc.push(f0, count);
+        voiced.push(f0, count);
+      },
+      scratch);
+  auto stats = acc.finish();
+
+  //! the estimator runs between the reads and the pushes, it gets the rest
+  std::int64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  std::int64_t decode = std::max<std::int64_t>(inner.nanos[StageDecode], 0);
+  std::int64_t push = std::max<std::int64_t>(inner.nanos[StageStats], 0);
+  clock.add(StageDecode, decode);
+  clock.add(StageStats, push);
+  clock.add(StageF0, total - decode - push);
+  return stats;
+}
+
+/*
+ * @brief cacheKey
+ * @param option == analysis options
+ * @param wav == source, not loaded
+ * @return key over the payload as stored, nothing is decoded
+ */
+static CacheKey cacheKey(const SpeechOptions &option, const _wavFile &wav) {
+  CacheKey key{};
+  key.length = wav.length;
+  if (wav.buf) {
+    key.pcm = hashBytes(wav.buf, sizeof(double) * wav.length);
+  } else {
+    //! every channel of the payload, the channel read is in the fields
+    key.pcm = hashBytes(wav.map.data, static_cast<std::size_t>(wav.length) *
+                                          std::max(wav.map.channels, 1) *
+                                          (wav.nbit / 8));
+  }
+  const double fields[] = {static_cast<double>(wav.fs),
+                           static_cast<double>(wav.channel),
+                           static_cast<double>(wav.buf ? 0 : wav.map.format),
+                           static_cast<double>(wav.nbit),
+                           static_cast<double>(option.estimator),
+                           static_cast<double>(option.stonemask),
+                           option.frame_period,
+                           option.f0_floor,
+                           option.f0_ceil,
+                           option.block_length,
+                           option.block_margin,
+                           static_cast<double>(option.vad),
+                           option.analysis_rate,
+                           static_cast<double>(option.parallel)};
+  key.options = hashBytes(fields, sizeof(fields));
+  return key;
+}
+
+/* @brief the main function of this module
+ * @param ctx == context that receive the result
+ * @param wav == opened source
+ * @return 0
+ * @detail this function feed the necessary data extracted from wav file to lib
+ * world to get the f0 data and to be processed into pitch 1,2,3,4. with
+ * option.vad only the speech regions are given to lib world. a signal too
+ * long to be analyzed in one piece goes block by block whatever the options.
+ * std::bad_alloc is left to analyzeWav.
+ */
+
+static int analyzeSignal(SpeechContext &ctx, _wavFile *wav) {
+  auto &result = ctx.result;
+  const auto option = effectiveOptions(ctx.options, wav->fs, wav->length);
+  auto &cache = ResultCache::shared();
+  //! the f0 track is indexed by int whatever the signal length
+  if (1000.0 * wav->length / wav->fs / option.frame_period >= INT_MAX) {
+    result.setStatus(1003, errCode.at(1003).c_str());
+    return 1003;
+  }
+  bool blocks = blockMode(option, wav->fs, wav->length);
+  VoicedAccumulator voiced(option.voiced_stats, ctx.voicedValues);
+  //! the cache keeps no f0 track in block mode to take the voiced stats from
+  bool cached = cache.enabled() && !(blocks && option.voiced_stats);
+  CacheKey key{};
+  if (cached) {
+    StageTimer timer(ctx.clock, StageCache);
+    key = cacheKey(option, *wav);
+    PitchStats stats{};
+    if (cache.find(key, stats, ctx.f0)) {
+      voiced.push(ctx.f0.data(), static_cast<int>(ctx.f0.size()));
+      result.voiced =
+          voiced.finish(option.percentiles, option.percentile_count);
+      result.setPitch(stats);
+      result.setStatus(0, errCode.at(0).c_str());
+      ctx.cacheHit = true;
+      return {};
+    }
+  }
+
+  if (!blocks) {
+    try {
+      StageTimer timer(ctx.clock, StageDecode);
+      wav->load(result, ctx.arena);
+    } catch (int e) {
+      return e;
+    }
+  }
+
+  int numOfFrame = getSamplesForF0(option, wav->fs, wav->length);
+  auto &regions = ctx.vad.regions;
+  regions.assign(1, FrameRange{0, numOfFrame});
+  if (option.vad) {
+    StageTimer timer(ctx.clock, StageVad);
+    detectSpeech(
+        option, wav->fs, wav->length,
+        [wav](std::int64_t start, int count, double *x) {
+          readSamples(*wav, start, count, x);
+        },
+        ctx.vad);
+    if (regions.empty()) {
+      result.setStatus(2000, errCode.at(2000).c_str());
+      return 2000;
+    }
+  }
+  bool whole = regions.size() == 1 && regions[0].first == 0 &&
+               regions[0].count == numOfFrame;
+
+  PitchStats stats{};
+  if (blocks) {
+    ctx.f0.clear();
+    stats = blockPitchStats(option, *wav, regions, ctx.scratch, voiced,
+                            ctx.clock);
+  } else {
+
+#if __DEBUG__ == 1
+    std::printf("\n\nSTART: list dari buf wav\n\n");
+    for (std::int64_t i = 0; i < wav->length; i++) {
+      std::printf(" %.2f ", wav->buf[i]);
+    }
+    std::printf("\n\nEND: list dari buf wav\n\n");
+#endif
+
+    try {
+      _f0 f0(result, ctx.arena, numOfFrame);
+      {
+        StageTimer timer(ctx.clock, StageF0);
+        auto read = [wav](std::int64_t start, int count, double *x) {
+          readSamples(*wav, start, count, x);
+        };
+        if (whole && !option.parallel) {
+          estimateF0(option, wav->buf, static_cast<int>(wav->length),
+                     wav->fs, f0.temporalPossition, f0.f0, &ctx.scratch);
+        } else {
+          //! stitched from the regions or the segments, silence in between
+          //! stays unvoiced
+          for (int i = 0; i < numOfFrame; i++) {
+            f0.temporalPossition[i] = i * option.frame_period / 1000.0;
+          }
+          int next{};
+          if (option.parallel) {
+            estimateF0Segments(option, wav->fs, wav->length, regions, read,
+                               ctx.segments, f0.f0);
+          } else {
+            estimateF0Regions(
+                option, wav->fs, wav->length, regions, read,
+                [&f0, &next](const double *frames, int count) {
+                  std::copy(frames, frames + count, f0.f0 + next);
+                  next += count;
+                },
+                ctx.scratch);
+          }
+        }
+      }
+
+#if __DEBUG__ == 1
+      std::printf("\n\nSTART: list dari F0:\n\n");
+      for (int i = 0; i < f0.numOfFrame; i++) {
+        std::printf(" %.2f ", f0.f0[i]);
+      }
+      std::printf("\n\nEND: list dari F0:\n\n");
+#endif
+      {
+        //! pitch 1,2,3,4 from one fused pass over the f0 track
+        StageTimer timer(ctx.clock, StageStats);
+        stats = computePitchStats(f0.f0, f0.numOfFrame);
+        voiced.push(f0.f0, f0.numOfFrame);
+      }
+      ctx.f0.assign(f0.f0, f0.f0 + f0.numOfFrame);
+    } catch (int e) {
+      return e;
+    }
+  }
+
+  {
+    StageTimer timer(ctx.clock, StageStats);
+    result.voiced = voiced.finish(option.percentiles, option.percentile_count);
+  }
+  result.setPitch(stats);
+  result.setStatus(0, errCode.at(0).c_str());
+  if (cached) {
+    StageTimer timer(ctx.clock, StageCache);
+    cache.insert(key, stats, ctx.f0);
+  }
+  return {};
+}
+
+/*
+ * @brief analyzeSignal, with an allocation failure anywhere in the estimator
+ * or the statistics reported as 3000. nothing may throw past it, it runs in
+ * pool tasks and under the exported functions.
+ */
+static int analyzeWav(SpeechContext &ctx, _wavFile *wav) {
+  try {
+    return analyzeSignal(ctx, wav);
+  } catch (std::bad_alloc &e) {
+    std::cerr << 3000 << " " << errCode.at(3000) << " " << e.what() << "\n";
+    ctx.result.setStatus(3000, errCode.at(3000).c_str(), e.what());
+    return 3000;
+  }
+}
+
+/*
+ * @brief forget the last analysis of ctx, its buffers are kept
+ */
+static void resetAnalysis(SpeechContext &ctx) {
+  ctx.result.reset();
+  ctx.arena.reset();
+  ctx.resultSize = 0;
+  ctx.f0.clear();
+  ctx.clock.reset();
+  ctx.cacheHit = false;
+  ctx.channelResults.clear();
+}
+
+/*
+ * @brief analyzeChannels
+ * @param ctx == context that receive the result
+ * @param wav == opened multichannel source
+ * @return 0 when every channel succeed, 2005 when only some did, otherwise
+ * the status of the first channel
+ * @detail the channels are de-interleaved in a single pass over the payload,
+ * then analyzed in parallel on the shared thread pool, each in a context of
+ * its own. in block mode every channel decodes its own blocks from the
+ * payload instead, so no channel is ever held whole. the pitch, voiced stats
+ * and f0 of the result repeat the first channel that succeed, the first
+ * channel when none did. the stage times of the channels are summed, the
+ * time spent over all of them rather than the wall time.
+ */
+static int analyzeChannels(SpeechContext &ctx, _wavFile *wav) {
+  auto &result = ctx.result;
+  int count = wav->map.channels;
+  while (static_cast<int>(ctx.channels.size()) < count) {
+    ctx.channels.emplace_back(new SpeechContext{});
+  }
+
+  double **x{};
+  auto option = effectiveOptions(ctx.options, wav->fs, wav->length);
+  if (!blockMode(option, wav->fs, wav->length)) {
+    try {
+      StageTimer timer(ctx.clock, StageDecode);
+      x = ctx.arena.take<double *>(count);
+      for (int c = 0; c < count; c++) {
+        x[c] = ctx.arena.take<double>(wav->length);
+      }
+      wavdecodechannels(&wav->map, 0, static_cast<int>(wav->length), x);
+    } catch (std::bad_alloc &e) {
+      std::cerr << 3000 << " " << errCode.at(3000) << " " << e.what() << "\n";
+      result.setStatus(3000, errCode.at(3000).c_str(), e.what());
+      return 3000;
+    }
+  }
+
+  std::vector<ThreadPool::Task> tasks;
+  tasks.reserve(count);
+  for (int c = 0; c < count; c++) {
+    auto &channel = *ctx.channels[c];
+    channel.options = ctx.options;
+    tasks.emplace_back([&channel, x, c, wav] {
+      resetAnalysis(channel);
+      _wavFile *signal{};
+      try {
+        StageTimer timer(channel.clock, StageOpen);
+        void *place = channel.arena.take<_wavFile>(1);
+        if (x) {
+          signal = new (place) _wavFile(
+              channel.result, x[c], static_cast<int>(wav->length), wav->fs);
+        } else {
+          signal = new (place) _wavFile(channel.result, wav->map, c);
+        }
+      } catch (int) {
+        return;
+      } catch (std::bad_alloc &e) {
+        channel.result.setStatus(3000, errCode.at(3000).c_str(), e.what());
+        return;
+      }
+      analyzeWav(channel, signal);
+      signal->~_wavFile();
+    });
+  }
+  ThreadPool::shared().run(tasks);
+
+  for (int c = 0; c < count; c++) {
+    const auto &channel = *ctx.channels[c];
+    ctx.channelResults.push_back(channel.result);
+    for (int s = 0; s < StageCount; s++) {
+      if (channel.clock.nanos[s] >= 0) {
+        ctx.clock.add(static_cast<Stage>(s), channel.clock.nanos[s]);
+      }
+    }
+  }
+  int shown{-1};
+  int failures{};
+  for (int c = 0; c < count; c++) {
+    if (ctx.channels[c]->result.status != 0) {
+      failures++;
+    } else if (shown < 0) {
+      shown = c;
+    }
+  }
+  const auto &channel = *ctx.channels[std::max(shown, 0)];
+  result = channel.result;
+  ctx.f0 = channel.f0;
+  ctx.cacheHit = channel.cacheHit;
+  if (failures > 0 && failures < count) {
+    result.setStatus(2005, errCode.at(2005).c_str());
+  }
+  return result.status;
+}
+
+/*
+ * @brief open a source with the matching _wavFile constructor and analyze it
+ * @param ctx == context that receive the result
+ * @param source == arguments of the _wavFile constructor after the result
+ * @return 0 == succes, non zero err in error
+ */
+template <typename... Source>
+static int analyzeSource(SpeechContext &ctx, Source... source) {
+  auto &result = ctx.result;
+  resetAnalysis(ctx);
+  int err{};
+  if (!validF0Options(ctx.options)) {
+    result.setStatus(1003, errCode.at(1003).c_str());
+    err = 1003;
+  } else {
+    _wavFile *wav{};
+    try {
+      StageTimer timer(ctx.clock, StageOpen);
+      wav = new (ctx.arena.take<_wavFile>(1)) _wavFile(result, source...);
+    } catch (int e) {
+      err = e;
+    } catch (std::bad_alloc &e) {
+      result.setStatus(3000, errCode.at(3000).c_str(), e.what());
+      err = 3000;
+    }
+    if (wav) {
+      err = wav->map.channels > 1 ? analyzeChannels(ctx, wav)
+                                  : analyzeWav(ctx, wav);
+      wav->~_wavFile();
+    }
+  }
+  recordAnalysis(ctx.clock, err, ctx.cacheHit);
+  return err;
+}
+
+/*
+ * @brief serialize the result as json, timed as the serialize stage. the
+ * stages of the analysis are added when the options ask for them, the
+ * serialization itself can only show in SpeechGetStats.
+ * @param channels == add the results of the channels of a multichannel file
+ * @return bytes needed including the terminating zero, see writeResultJson
+ */
+static std::size_t serialize(const SpeechContext &ctx, char *dst,
+                             std::size_t capacity, bool channels = true) {
+  StageClock clock{};
+  std::size_t ret;
+  {
+    StageTimer timer(clock, StageSerialize);
+    const StageClock *timings = ctx.options.timings ? &ctx.clock : nullptr;
+    const auto &results = ctx.channelResults;
+    ret = writeResultJson(
+        ctx.result, channels && !results.empty() ? results.data() : nullptr,
+        static_cast<int>(results.size()), timings, dst, capacity);
+  }
+  recordStages(clock);
+  return ret;
+}
+
+/*
+ * @brief json of the last result, serialized into the context once
+ */
+static const char *resultText(SpeechContext &ctx) {
+  auto &text = ctx.resultText;
+  if (ctx.resultSize == 0) {
+    ctx.resultSize = serialize(ctx, text.data(), text.size());
+    if (ctx.resultSize > text.size()) {
+      text.resize(ctx.resultSize);
+      serialize(ctx, text.data(), text.size());
+    }
+  }
+  return text.data();
+}
+
+/*
+ * @param ctx == context that receive the result
+ * @param filename == wav file path in c string type
+ * @return 0 == succes, non zero err in error
+ */
+int __PitchAnalyzer(SpeechContext &ctx, const char *fileName) {
+  return analyzeSource(ctx, fileName);
+}
+
+/*
+ * @brief the plain value form of the last result of ctx
+ */
+static PitchResult pitchResult(const SpeechContext &ctx) {
+  PitchResult ret{};
+  const auto &result = ctx.result;
+  ret.status = result.status;
+  ret.frames = result.stats.frames;
+  //! a multichannel result keeps the pitch of the channels that succeed
+  if (result.status == 0 || result.status == 2005) {
+    ret.pitch1 = result.pitch[0];
+    ret.pitch2 = result.pitch[1];
+    ret.pitch3 = result.pitch[2];
+    ret.pitch4 = result.pitch[3];
+  }
+  if (result.stats.frames > 0) {
+    ret.voiced_ratio =
+        static_cast<double>(result.stats.voiced) / result.stats.frames;
+  }
+  for (auto ns : ctx.clock.nanos) {
+    if (ns > 0) ret.elapsed_ms += ns * 1e-6;
+  }
+  const auto &voiced = result.voiced;
+  ret.voiced_mean = voiced.mean;
+  ret.voiced_sd = voiced.sd;
+  ret.semitone_mean = voiced.semitoneMean;
+  ret.semitone_sd = voiced.semitoneSd;
+  ret.jitter = voiced.jitter;
+  ret.median = voiced.median;
+  ret.percentile_count = voiced.percentileCount;
+  std::copy(voiced.percentile, voiced.percentile + voiced.percentileCount,
+            ret.percentiles);
+  return ret;
+}
+
+/*
+ * @brief copy a string into a new[] allocated c string, the same ownership
+ * PitchAnalyzer2 has always handed out
+ */
+static char *newCString(const char *x) {
+  auto length = std::strlen(x);
+  char *ret = new char[length + 1]{};
+  std::memcpy(ret, x, length);
+  return ret;
+}
+
+/*
+ * @brief read the header of fileName into out
+ * @return the status, the error the analysis would fail with when opening
+ */
+static int probeFile(const char *fileName, SpeechProbeResult &out) {
+  out = SpeechProbeResult{};
+  WavInfo info{};
+  auto err = fileName ? wavprobe(fileName, &info) : 0;
+  if (err != 1) {
+    out.status = err == 0 ? 1000 : 1002;
+    return out.status;
+  }
+  out.fs = info.fs;
+  out.nbit = info.nbit;
+  out.format = info.format;
+  out.channels = info.channels;
+  out.frames = info.frames;
+  out.data_offset = info.data_offset;
+  out.duration = info.fs > 0 ? static_cast<double>(info.frames) / info.fs : 0;
+  return 0;
+}
+
+/*
+ * @brief probe count files on the shared pool, a task probes a run of files
+ * since one open and one read are too little work for a task of their own
+ * @return the number of failed probes
+ */
+static int probeFiles(const char *const *fileNames, int count,
+                      SpeechProbeResult *out) {
+  const int perTask = 32;
+  std::atomic<int> failed{};
+  std::vector<ThreadPool::Task> tasks;
+  tasks.reserve(count / perTask + 1);
+  for (int first = 0; first < count; first += perTask) {
+    int last = std::min(first + perTask, count);
+    tasks.emplace_back([first, last, fileNames, out, &failed] {
+      for (int i = first; i < last; i++) {
+        if (probeFile(fileNames[i], out[i]) != 0) failed++;
+      }
+    });
+  }
+  ThreadPool::shared().run(tasks);
+  return failed;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief SpeechInitializeOptions
+ * @param options == receive the default options, harvest with the world
+ * default frame period and f0 range
+ */
+DLLEXPORT void ADDCALL SpeechInitializeOptions(SpeechOptions *options) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker,
+                   "/export:SpeechInitializeOptions=_SpeechInitializeOptions@4"));
+#endif
+  initializeF0Options(options);
+}
+
+/*
+ * @brief PitchAnalyzer
+ * @param fileName == wav file name in c string
+ * @param dst == pointer of string to store the c string result, the caller need
+ * to allocated this first and then free it. SPEECH_RESULT_MAX bytes always
+ * fit, PitchAnalyzerInto takes the size of dst. the channels of a
+ * multichannel file are left out when they do not fit.
+ * @return 0 == succes, non zero err in error
+ */
+DLLEXPORT int ADDCALL PitchAnalyzer(char *const fileName, char *const dst) {
+//! macro to remove function decoration in the library if using msvc compiler
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:PitchAnalyzer=_PitchAnalyzer@8"));
+#endif
+  SpeechContext ctx{};
+  auto err = __PitchAnalyzer(ctx, fileName);
+  if (serialize(ctx, dst, SPEECH_RESULT_MAX) > SPEECH_RESULT_MAX) {
+    serialize(ctx, dst, SPEECH_RESULT_MAX, false);
+  }
+  return err == 0 ? 0 : err;
+}
+
+/*
+ * @brief PitchAnalyzerInto
+ * @param fileName == wav file name in c string
+ * @param dst == receive the c string result, may be nullptr when capacity is 0
+ * @param capacity == size of dst in bytes
+ * @return bytes needed for the result including the terminating zero. when it
+ * is more than capacity dst receive an empty string, a buffer of
+ * SPEECH_RESULT_MAX bytes is always enough for a mono file. the status is in
+ * the json.
+ * @detail nothing is allocated for the result, the json is written straight
+ * into dst.
+ */
+DLLEXPORT size_t ADDCALL PitchAnalyzerInto(const char *fileName, char *dst,
+                                           size_t capacity) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:PitchAnalyzerInto=_PitchAnalyzerInto@12"));
+#endif
+  SpeechContext ctx{};
+  __PitchAnalyzer(ctx, fileName);
+  return serialize(ctx, dst, capacity);
+}
+
+/*
+ * @brief PitchAnalyzer2
+ * @param fileName == wav file name in c string
+ * @return pointer of c string result.
+ */
+DLLEXPORT char *ADDCALL PitchAnalyzer2(char const *fileName) {
+//! macro to remove function decoration in the library if using msvc compiler
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:PitchAnalyzer2=_PitchAnalyzer2@4"));
+#endif
+  SpeechContext ctx{};
+  __PitchAnalyzer(ctx, fileName);
+  return newCString(resultText(ctx));
+}
+
+/*
+ * @brief PitchAnalyzerBatch
+ * @param fileNames == array of wav file names in c string
+ * @param count == number of files
+ * @param results == array of count pointers, each one receive a c string
+ * result allocated the same way as PitchAnalyzer2
+ * @param options == analysis options for every file, nullptr for defaults
+ * @return 0 == every file succeed, otherwise the number of failed files
+ * @detail files are analyzed in parallel on the shared thread pool. every
+ * header is probed first and the longest recordings, in seconds times
+ * channels, are scheduled first so a long one does not start last and keep
+ * one core busy while the others idle.
+ */
+DLLEXPORT int ADDCALL PitchAnalyzerBatch(const char *const *fileNames,
+                                         int count, char **results,
+                                         const SpeechOptions *options) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:PitchAnalyzerBatch=_PitchAnalyzerBatch@16"));
+#endif
+  if (count <= 0) return 0;
+  std::vector<SpeechProbeResult> probes(count);
+  probeFiles(fileNames, count, probes.data());
+  std::vector<double> cost(count);
+  std::vector<int> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  for (int i = 0; i < count; i++) {
+    cost[i] = probes[i].duration * std::max(probes[i].channels, 1);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&cost](int a, int b) { return cost[a] > cost[b]; });
+
+  //! one context per worker at most, reused from file to file so their
+  //! arenas are reset rather than freed
+  auto &pool = ThreadPool::shared();
+  int contexts = static_cast<int>(
+      std::min<std::size_t>(count, pool.size() + 1));
+  std::unique_ptr<SpeechContext[]> ctxs(new SpeechContext[contexts]{});
+  std::vector<SpeechContext *> idle;
+  for (int i = 0; i < contexts; i++) {
+    if (options) ctxs[i].options = *options;
+    idle.push_back(&ctxs[i]);
+  }
+  std::mutex idleLock;
+
+  std::atomic<int> failed{};
+  std::vector<ThreadPool::Task> tasks;
+  tasks.reserve(count);
+  for (auto i : order) {
+    tasks.emplace_back([i, fileNames, results, options, &idle, &idleLock,
+                        &failed] {
+      SpeechContext *ctx{};
+      {
+        std::lock_guard<std::mutex> lock(idleLock);
+        if (!idle.empty()) {
+          ctx = idle.back();
+          idle.pop_back();
+        }
+      }
+      //! a thread running tasks of another batch too may exceed the count
+      std::unique_ptr<SpeechContext> extra;
+      if (!ctx) {
+        extra.reset(new SpeechContext{});
+        if (options) extra->options = *options;
+        ctx = extra.get();
+      }
+      if (__PitchAnalyzer(*ctx, fileNames[i]) != 0) failed++;
+      results[i] = newCString(resultText(*ctx));
+      if (extra) return;
+      std::lock_guard<std::mutex> lock(idleLock);
+      idle.push_back(ctx);
+    });
+  }
+  pool.run(tasks);
+  return failed;
+}
+
+/*
+ * @brief SpeechProbe
+ * @param fileName == wav file name in c string
+ * @param out == receive the header
+ * @return 0 == success, otherwise the status in out
+ * @detail only the riff chunks are read, a file of any size costs an open and
+ * usually a single 4 KB read.
+ */
+DLLEXPORT int ADDCALL SpeechProbe(const char *fileName,
+                                  SpeechProbeResult *out) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechProbe=_SpeechProbe@8"));
+#endif
+  if (!out) return 1003;
+  return probeFile(fileName, *out);
+}
+
+/*
+ * @brief SpeechProbeMany
+ * @param fileNames == array of wav file names in c string
+ * @param count == number of files
+ * @param out == array of count results
+ * @return the number of files whose status is not 0
+ * @detail the files are probed in parallel on the shared thread pool, the
+ * durations are meant for scheduling batches before anything is decoded.
+ */
+DLLEXPORT int ADDCALL SpeechProbeMany(const char *const *fileNames, int count,
+                                      SpeechProbeResult *out) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechProbeMany=_SpeechProbeMany@12"));
+#endif
+  if (count <= 0) return 0;
+  if (!fileNames || !out) return count;
+  return probeFiles(fileNames, count, out);
+}
+
+/*
+ * @brief PitchAnalyzeFile
+ * @param fileName == wav file name in c string
+ * @param options == analysis options, nullptr for defaults
+ * @return the result as plain values, status carries the error code. no json
+ * is built or serialized on this path.
+ */
+DLLEXPORT PitchResult ADDCALL PitchAnalyzeFile(const char *fileName,
+                                               const SpeechOptions *options) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:PitchAnalyzeFile=_PitchAnalyzeFile@12"));
+#endif
+  SpeechContext ctx{};
+  if (options) ctx.options = *options;
+  __PitchAnalyzer(ctx, fileName);
+  return pitchResult(ctx);
+}
+
+/*
+ * @brief SpeechCreate
+ * @return new analysis context, release it with SpeechDestroy. nullptr when
+ * the context cannot be allocated.
+ */
+DLLEXPORT SpeechContext *ADDCALL SpeechCreate(void) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechCreate=_SpeechCreate@0"));
+#endif
+  return new (std::nothrow) SpeechContext{};
+}
+
+/*
+ * @brief SpeechSetOptions
+ * @param ctx == context from SpeechCreate
+ * @param options == options used by the following SpeechAnalyze calls,
+ * nullptr for defaults
+ * @return 0 == succes, 1003 when ctx is nullptr or the options are invalid,
+ * ctx is then left unchanged
+ */
+DLLEXPORT int ADDCALL SpeechSetOptions(SpeechContext *ctx,
+                                       const SpeechOptions *options) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechSetOptions=_SpeechSetOptions@8"));
+#endif
+  if (!ctx) return 1003;
+  SpeechOptions opt{};
+  if (options) {
+    opt = *options;
+  } else {
+    initializeF0Options(&opt);
+  }
+  if (!validF0Options(opt)) return 1003;
+  ctx->options = opt;
+  return 0;
+}
+
+/*
+ * @brief SpeechAnalyze
+ * @param ctx == context from SpeechCreate
+ * @param fileName == wav file name in c string
+ * @return 0 == succes, non zero err in error. the json result is available
+ * from SpeechResult either way.
+ */
+DLLEXPORT int ADDCALL SpeechAnalyze(SpeechContext *ctx, const char *fileName) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechAnalyze=_SpeechAnalyze@8"));
+#endif
+  auto err = __PitchAnalyzer(*ctx, fileName);
+  return err;
+}
+
+/*
+ * @brief PitchAnalyzeBuffer
+ * @param ctx == context from SpeechCreate
+ * @param samples == mono signal scaled to [-1, 1), used in place
+ * @param n == number of samples
+ * @param fs == sampling frequency
+ * @return 0 == succes, non zero err in error. the json result is available
+ * from SpeechResult either way.
+ */
+DLLEXPORT int ADDCALL PitchAnalyzeBuffer(SpeechContext *ctx,
+                                         const double *samples, int n,
+                                         int fs) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:PitchAnalyzeBuffer=_PitchAnalyzeBuffer@16"));
+#endif
+  auto err = analyzeSource(*ctx, samples, n, fs);
+  return err;
+}
+
+/*
+ * @brief PitchAnalyzeBufferInt16
+ * @param ctx == context from SpeechCreate
+ * @param samples == mono 16 bit pcm, decoded like a 16 bit wav payload
+ * @param n == number of samples
+ * @param fs == sampling frequency
+ * @return 0 == succes, non zero err in error
+ */
+DLLEXPORT int ADDCALL PitchAnalyzeBufferInt16(SpeechContext *ctx,
+                                              const int16_t *samples, int n,
+                                              int fs) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker,
+                   "/export:PitchAnalyzeBufferInt16=_PitchAnalyzeBufferInt16@16"));
+#endif
+  WavFile pcm{};
+  pcm.fs = fs;
+  pcm.nbit = 16;
+  pcm.format = 1;
+  pcm.channels = 1;
+  pcm.length = samples ? n : 0;
+  pcm.data = reinterpret_cast<const unsigned char *>(samples);
+  auto err = analyzeSource(*ctx, pcm);
+  return err;
+}
+
+/*
+ * @brief PitchAnalyzeWavBytes
+ * @param ctx == context from SpeechCreate
+ * @param riff == a whole wav file in memory
+ * @param len == size of riff in bytes
+ * @return 0 == succes, non zero err in error
+ */
+DLLEXPORT int ADDCALL PitchAnalyzeWavBytes(SpeechContext *ctx,
+                                           const void *riff, size_t len) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker,
+                   "/export:PitchAnalyzeWavBytes=_PitchAnalyzeWavBytes@12"));
+#endif
+  WavFile pcm{};
+  if (wavparse(riff, len, &pcm) != 1) pcm.length = 0;
+  auto err = analyzeSource(*ctx, pcm);
+  return err;
+}
+
+/*
+ * @brief SpeechPitchResult
+ * @param ctx == context from SpeechCreate
+ * @param out == receive the last result as plain values, may be nullptr
+ * @return status of the last analysis
+ */
+DLLEXPORT int ADDCALL SpeechPitchResult(SpeechContext *ctx, PitchResult *out) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechPitchResult=_SpeechPitchResult@8"));
+#endif
+  auto ret = pitchResult(*ctx);
+  if (out) *out = ret;
+  return ret.status;
+}
+
+/*
+ * @brief SpeechChannelCount
+ * @param ctx == context from SpeechCreate
+ * @return number of channels of the last analysis with a result of their
+ * own, 0 for a mono source
+ */
+DLLEXPORT int ADDCALL SpeechChannelCount(SpeechContext *ctx) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechChannelCount=_SpeechChannelCount@4"));
+#endif
+  return static_cast<int>(ctx->channelResults.size());
+}
+
+/*
+ * @brief SpeechChannelPitchResult
+ * @param ctx == context from SpeechCreate
+ * @param channel == 0 .. SpeechChannelCount - 1
+ * @param out == receive the result of the channel as plain values, may be
+ * nullptr
+ * @return status of the channel, 1003 when there is no such channel
+ */
+DLLEXPORT int ADDCALL SpeechChannelPitchResult(SpeechContext *ctx,
+                                               int channel, PitchResult *out) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(
+      linker, "/export:SpeechChannelPitchResult=_SpeechChannelPitchResult@12"));
+#endif
+  if (channel < 0 ||
+      channel >= static_cast<int>(ctx->channelResults.size())) {
+    return 1003;
+  }
+  auto ret = pitchResult(*ctx->channels[channel]);
+  if (out) *out = ret;
+  return ret.status;
+}
+
+/*
+ * @brief SpeechF0
+ * @param ctx == context from SpeechCreate
+ * @param n == receive the number of frames, may be nullptr
+ * @return f0 track of the last analysis, valid until the next call on ctx.
+ * empty when the analysis ran in blocks or failed.
+ */
+DLLEXPORT const double *ADDCALL SpeechF0(SpeechContext *ctx, int *n) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechF0=_SpeechF0@8"));
+#endif
+  if (n) *n = static_cast<int>(ctx->f0.size());
+  return ctx->f0.data();
+}
+
+/*
+ * @brief SpeechArenaPeak
+ * @param ctx == context from SpeechCreate
+ * @return most bytes of signal and f0 buffers one analysis on ctx needed
+ */
+DLLEXPORT size_t ADDCALL SpeechArenaPeak(SpeechContext *ctx) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechArenaPeak=_SpeechArenaPeak@4"));
+#endif
+  return ctx->arena.peak();
+}
+
+/*
+ * @brief SpeechCacheConfigure
+ * @param entries == results kept in memory, 0 disables the cache
+ * @param directory == directory of the on disk tier, nullptr for memory only
+ * @return 0 == succes, 1001 when the disk tier cannot be opened, 1005 when
+ * another process holds it. the memory tier is used anyway.
+ * @detail a cached result is keyed by a hash of the samples as stored in the
+ * file plus the analysis options, a hit skips decoding and f0 estimation.
+ */
+DLLEXPORT int ADDCALL SpeechCacheConfigure(size_t entries,
+                                           const char *directory) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker,
+                   "/export:SpeechCacheConfigure=_SpeechCacheConfigure@8"));
+#endif
+  switch (ResultCache::shared().configure(entries, directory)) {
+    case ResultCache::DiskReady:
+      return 0;
+    case ResultCache::DiskLocked:
+      return 1005;
+    default:
+      return 1001;
+  }
+}
+
+/*
+ * @brief SpeechGetStats
+ * @return c string json of the counters of every analysis in the process:
+ * - analyses, errors, cache_hits == cumulative counts
+ * - bucket_bounds_us == upper bounds of the histogram buckets, the last
+ * bucket has no bound
+ * - stages == per stage count, total_ms and histogram
+ * the string is owned by the calling thread and valid until its next call.
+ */
+DLLEXPORT const char *ADDCALL SpeechGetStats(void) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechGetStats=_SpeechGetStats@0"));
+#endif
+  thread_local std::string ret;
+  auto totals = stageTotals();
+  nlohmann::json stats;
+  stats["analyses"] = totals.analyses;
+  stats["errors"] = totals.errors;
+  stats["cache_hits"] = totals.cacheHits;
+  stats["bucket_bounds_us"] = std::vector<double>(
+      kStageBucketBound, kStageBucketBound + kStageBuckets - 1);
+  auto &stages = stats["stages"];
+  for (int s = 0; s < StageCount; s++) {
+    auto &stage = stages[stageName(static_cast<Stage>(s))];
+    stage["count"] = totals.count[s];
+    stage["total_ms"] = totals.nanos[s] * 1e-6;
+    stage["histogram"] = std::vector<std::uint64_t>(
+        totals.histogram[s], totals.histogram[s] + kStageBuckets);
+  }
+  ret = stats.dump();
+  return ret.c_str();
+}
+
+/*
+ * @brief SpeechResult
+ * @param ctx == context from SpeechCreate
+ * @return c string json result of the last SpeechAnalyze, owned by ctx and
+ * valid until the next SpeechAnalyze or SpeechDestroy on the same ctx.
+ */
+DLLEXPORT const char *ADDCALL SpeechResult(SpeechContext *ctx) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechResult=_SpeechResult@4"));
+#endif
+  return resultText(*ctx);
+}
+
+/*
+ * @brief SpeechResultInto
+ * @param ctx == context from SpeechCreate
+ * @param dst == receive the c string json result of the last analysis, may be
+ * nullptr when capacity is 0
+ * @param capacity == size of dst in bytes
+ * @return bytes needed including the terminating zero, dst receive an empty
+ * string when it is more than capacity. call again with a bigger dst, the
+ * analysis is not repeated.
+ */
+DLLEXPORT size_t ADDCALL SpeechResultInto(SpeechContext *ctx, char *dst,
+                                          size_t capacity) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechResultInto=_SpeechResultInto@12"));
+#endif
+  resultText(*ctx);
+  if (capacity == 0) return ctx->resultSize;
+  if (ctx->resultSize > capacity) {
+    dst[0] = '\0';
+  } else {
+    std::memcpy(dst, ctx->resultText.data(), ctx->resultSize);
+  }
+  return ctx->resultSize;
+}
+
+/*
+ * @brief SpeechDestroy
+ * @param ctx == context from SpeechCreate, may be nullptr
+ */
+DLLEXPORT void ADDCALL SpeechDestroy(SpeechContext *ctx) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechDestroy=_SpeechDestroy@4"));
+#endif
+  delete ctx;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,243 @@
+/*
+ * @file speechStream.cpp
+ * @brief push based pitch analysis of live audio
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "f0Estimator.hpp"
+#include "pitchStats.hpp"
+#include "speech.hpp"
+
+/*
+ * @brief SpeechStream struct
+ * @detail every buffer is sized by SpeechStreamCreate, a push only moves
+ * samples and runs the estimator on the blocks that became complete.
+ * - input == samples [inputStart, inputStart + inputCount) still needed
+ * - received == samples pushed so far
+ * - nextFrame == first frame not estimated yet
+ * - polled == frames already handed out by SpeechStreamPoll
+ */
+struct SpeechStream {
+  SpeechOptions options{};
+  int fs{};
+  double samplesPerFrame{};
+  int blockFrames{};
+  int marginFrames{};
+  int maxSamples{};
+  std::vector<double> input{};
+  int inputStart{};
+  int inputCount{};
+  int received{};
+  int nextFrame{};
+  int polled{};
+  F0Scratch scratch{};
+  std::vector<double> block{};
+  RunningPitch pitch{};
+  SampleReader read{};
+};
+
+namespace {
+
+int frameToSample(const SpeechStream &s, int frame) {
+  return static_cast<int>(std::round(std::max(frame, 0) * s.samplesPerFrame));
+}
+
+/*
+ * @brief estimate every block whose right margin has arrived, or everything
+ * left when flushing, then drop the samples no later block needs
+ */
+void processBlocks(SpeechStream &s, bool flush) {
+  int total =
+      flush ? getSamplesForF0(s.options, s.fs, s.received) : INT_MAX;
+  for (;;) {
+    int count = std::min(s.blockFrames, total - s.nextFrame);
+    if (count <= 0) break;
+    if (!flush &&
+        frameToSample(s, s.nextFrame + count + s.marginFrames) + 1 >
+            s.received) {
+      break;
+    }
+    estimateF0Range(s.options, s.fs, s.received, s.nextFrame, count,
+                    s.marginFrames, s.read, s.scratch, s.block.data());
+    s.pitch.push(s.block.data(), count);
+    s.nextFrame += count;
+
+    int keep = frameToSample(s, s.nextFrame - s.marginFrames);
+    int drop = std::min(keep - s.inputStart, s.inputCount);
+    if (drop > 0) {
+      std::memmove(s.input.data(), s.input.data() + drop,
+                   (s.inputCount - drop) * sizeof(double));
+      s.inputStart += drop;
+      s.inputCount -= drop;
+    }
+  }
+}
+
+void writePitch(const SpeechStream &s, double *pitch) {
+  if (!pitch) return;
+  auto stats = s.pitch.stats();
+  pitch[0] = stats.pitch1();
+  pitch[1] = stats.pitch2();
+  pitch[2] = stats.pitch3();
+  pitch[3] = stats.pitch4();
+}
+
+}  // namespace
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * @brief SpeechStreamCreate
+ * @param fs == sampling frequency of the pushed samples
+ * @param maxSeconds == longest stream accepted, every buffer is sized for it
+ * @param options == analysis options, nullptr for defaults
+ * @return new stream or nullptr when the options are invalid or the buffers
+ * cannot be allocated
+ */
+DLLEXPORT SpeechStream *ADDCALL SpeechStreamCreate(int fs, double maxSeconds,
+                                                   const SpeechOptions *options) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechStreamCreate=_SpeechStreamCreate@16"));
+#endif
+  SpeechOptions opt{};
+  if (options) {
+    opt = *options;
+  } else {
+    initializeF0Options(&opt);
+  }
+  if (opt.block_length <= 0.0) opt.block_length = 1.0;
+  if (fs <= 0 || maxSeconds <= 0.0 || maxSeconds * fs >= INT_MAX ||
+      !validF0Options(opt)) {
+    return nullptr;
+  }
+
+  auto *s = new (std::nothrow) SpeechStream{};
+  if (!s) return nullptr;
+  try {
+    s->options = opt;
+    s->fs = fs;
+    s->samplesPerFrame = fs * opt.frame_period / 1000.0;
+    s->blockFrames = std::max(
+        static_cast<int>(opt.block_length * 1000.0 / opt.frame_period), 1);
+    s->marginFrames =
+        static_cast<int>(std::ceil(opt.block_margin * 1000.0 / opt.frame_period));
+    s->maxSamples = static_cast<int>(maxSeconds * fs);
+
+    //! one block with both margins plus a block of slack for the next push
+    int window =
+        frameToSample(*s, s->blockFrames + 2 * s->marginFrames) + 2;
+    s->input.resize(window + frameToSample(*s, s->blockFrames));
+    s->scratch.x.reserve(window);
+    s->scratch.f0.reserve(getSamplesForF0(opt, fs, window));
+    s->scratch.temporalPositions.reserve(getSamplesForF0(opt, fs, window));
+    s->scratch.refined.reserve(getSamplesForF0(opt, fs, window));
+    //! the filter and the buffers at the analysis rate, before any push
+    auto &decimator = s->scratch.decimator;
+    int rate = decimator.configure(fs, opt.analysis_rate);
+    if (decimator.active()) {
+      int length = decimator.outputLength(window);
+      s->scratch.decimated.reserve(length);
+      s->scratch.decimatedPositions.reserve(
+          getSamplesForF0(opt, rate, length));
+      s->scratch.decimatedF0.reserve(getSamplesForF0(opt, rate, length));
+    }
+    s->block.resize(s->blockFrames);
+    s->pitch = RunningPitch(getSamplesForF0(opt, fs, s->maxSamples));
+  } catch (std::bad_alloc &) {
+    delete s;
+    return nullptr;
+  }
+  s->read = [s](std::int64_t start, int count, double *x) {
+    std::copy(s->input.begin() + (start - s->inputStart),
+              s->input.begin() + (start - s->inputStart + count), x);
+  };
+  return s;
+}
+
+/*
+ * @brief SpeechStreamPush
+ * @param s == stream from SpeechStreamCreate
+ * @param samples == next n samples scaled to [-1, 1)
+ * @param n == number of samples
+ * @return 0 == succes, 1004 when maxSeconds is exceeded. the samples beyond
+ * it are dropped.
+ * @detail the work done is proportional to n. the stream's own buffers and
+ * the decimation filter are sized by SpeechStreamCreate, only the temporary
+ * buffers of the world estimator are allocated while a block is estimated.
+ */
+DLLEXPORT int ADDCALL SpeechStreamPush(SpeechStream *s, const double *samples,
+                                       int n) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechStreamPush=_SpeechStreamPush@12"));
+#endif
+  int err{};
+  if (n > s->maxSamples - s->received) {
+    n = s->maxSamples - s->received;
+    err = 1004;
+  }
+  while (n > 0) {
+    int take =
+        std::min(n, static_cast<int>(s->input.size()) - s->inputCount);
+    std::copy(samples, samples + take, s->input.begin() + s->inputCount);
+    s->inputCount += take;
+    s->received += take;
+    samples += take;
+    n -= take;
+    processBlocks(*s, false);
+  }
+  return err;
+}
+
+/*
+ * @brief SpeechStreamPoll
+ * @param s == stream from SpeechStreamCreate
+ * @param f0 == receive the f0 frames estimated since the last poll, may be
+ * nullptr when capacity is 0
+ * @param capacity == size of f0
+ * @param pitch == receive the running pitch 1,2,3,4, may be nullptr
+ * @return number of frames written to f0
+ */
+DLLEXPORT int ADDCALL SpeechStreamPoll(SpeechStream *s, double *f0,
+                                       int capacity, double *pitch) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechStreamPoll=_SpeechStreamPoll@16"));
+#endif
+  int count = std::max(std::min(capacity, s->pitch.size() - s->polled), 0);
+  std::copy(s->pitch.frames() + s->polled,
+            s->pitch.frames() + s->polled + count, f0);
+  s->polled += count;
+  writePitch(*s, pitch);
+  return count;
+}
+
+/*
+ * @brief SpeechStreamClose
+ * @param s == stream from SpeechStreamCreate, released by this call
+ * @param pitch == receive the final pitch 1,2,3,4 including the samples not
+ * yet covered by a complete block, may be nullptr
+ */
+DLLEXPORT void ADDCALL SpeechStreamClose(SpeechStream *s, double *pitch) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  __pragma(comment(linker, "/export:SpeechStreamClose=_SpeechStreamClose@8"));
+#endif
+  if (!s) return;
+  if (s->received > 0) processBlocks(*s, true);
+  writePitch(*s, pitch);
+  delete s;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,114 @@
+/*
+ * @file stageTimer.cpp
+ * @brief per stage latency of the analysis
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "stageTimer.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+const double kStageBucketBound[kStageBuckets - 1] = {10,  100,  1e3, 1e4,
+                                                     1e5, 1e6, 1e7};
+
+namespace {
+
+/*
+ * @brief counters of one thread. only the owning thread writes, the atomics
+ * are relaxed and only there so stageTotals() may read them concurrently.
+ */
+struct ThreadCounters {
+  std::atomic<std::uint64_t> analyses{};
+  std::atomic<std::uint64_t> errors{};
+  std::atomic<std::uint64_t> cacheHits{};
+  std::atomic<std::uint64_t> count[StageCount]{};
+  std::atomic<std::uint64_t> nanos[StageCount]{};
+  std::atomic<std::uint64_t> histogram[StageCount][kStageBuckets]{};
+};
+
+void bump(std::atomic<std::uint64_t> &x, std::uint64_t v) {
+  x.store(x.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+/*
+ * @brief every thread's counters, kept after the thread exits so the totals
+ * never go backwards. never destroyed, like ThreadPool::shared().
+ */
+struct Registry {
+  std::mutex lock;
+  std::vector<std::shared_ptr<ThreadCounters>> threads;
+};
+
+Registry &registry() {
+  static Registry *r = new Registry();
+  return *r;
+}
+
+ThreadCounters &local() {
+  thread_local std::shared_ptr<ThreadCounters> mine = [] {
+    auto c = std::make_shared<ThreadCounters>();
+    auto &r = registry();
+    std::lock_guard<std::mutex> lk(r.lock);
+    r.threads.push_back(c);
+    return c;
+  }();
+  return *mine;
+}
+
+int bucket(std::int64_t ns) {
+  double us = ns * 1e-3;
+  int b = 0;
+  while (b < kStageBuckets - 1 && us > kStageBucketBound[b]) b++;
+  return b;
+}
+
+}  // namespace
+
+const char *stageName(Stage stage) {
+  static const char *const names[StageCount] = {
+      "open", "cache", "decode", "vad", "f0", "stats", "serialize"};
+  return names[stage];
+}
+
+void recordStages(const StageClock &clock) {
+  auto &c = local();
+  for (int s = 0; s < StageCount; s++) {
+    if (clock.nanos[s] < 0) continue;
+    bump(c.count[s], 1);
+    bump(c.nanos[s], static_cast<std::uint64_t>(clock.nanos[s]));
+    bump(c.histogram[s][bucket(clock.nanos[s])], 1);
+  }
+}
+
+void recordAnalysis(const StageClock &clock, int status, bool cacheHit) {
+  auto &c = local();
+  bump(c.analyses, 1);
+  if (status != 0) bump(c.errors, 1);
+  if (cacheHit) bump(c.cacheHits, 1);
+  recordStages(clock);
+}
+
+StageTotals stageTotals() {
+  StageTotals ret{};
+  auto &r = registry();
+  std::lock_guard<std::mutex> lk(r.lock);
+  for (auto &c : r.threads) {
+    ret.analyses += c->analyses.load(std::memory_order_relaxed);
+    ret.errors += c->errors.load(std::memory_order_relaxed);
+    ret.cacheHits += c->cacheHits.load(std::memory_order_relaxed);
+    for (int s = 0; s < StageCount; s++) {
+      ret.count[s] += c->count[s].load(std::memory_order_relaxed);
+      ret.nanos[s] += c->nanos[s].load(std::memory_order_relaxed);
+      for (int b = 0; b < kStageBuckets; b++) {
+        ret.histogram[s][b] += c->histogram[s][b].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,108 @@
+/*
+ * @file threadPool.cpp
+ * @brief fixed size work stealing thread pool
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "threadPool.hpp"
+
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  for (unsigned i = 0; i < threads; i++) {
+    queues.emplace_back(new Queue{});
+  }
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lk(sleepLock);
+    stop = true;
+  }
+  wake.notify_all();
+  for (auto &w : workers) w.join();
+}
+
+ThreadPool &ThreadPool::shared() {
+  static ThreadPool *pool = new ThreadPool();
+  return *pool;
+}
+
+/*
+ * @brief take one task, own queue front first then steal from the back of
+ * the other queues
+ * @param self == queue index to start with
+ * @return true when a task was executed
+ */
+bool ThreadPool::tryRun(unsigned self) {
+  Item item{};
+  bool found{};
+  auto n = static_cast<unsigned>(queues.size());
+  for (unsigned i = 0; i < n && !found; i++) {
+    auto &q = *queues[(self + i) % n];
+    std::lock_guard<std::mutex> lk(q.lock);
+    if (q.items.empty()) continue;
+    if (i == 0) {
+      item = std::move(q.items.front());
+      q.items.pop_front();
+    } else {
+      item = std::move(q.items.back());
+      q.items.pop_back();
+    }
+    found = true;
+  }
+  if (!found) return false;
+  {
+    std::lock_guard<std::mutex> lk(sleepLock);
+    queued--;
+  }
+
+  item.task();
+
+  //! the group lives on the stack of run(), only touch it under its lock
+  std::lock_guard<std::mutex> lk(item.group->lock);
+  if (--item.group->pending == 0) item.group->done.notify_all();
+  return true;
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+  for (;;) {
+    if (tryRun(self)) continue;
+    std::unique_lock<std::mutex> lk(sleepLock);
+    wake.wait(lk, [this] { return stop || queued > 0; });
+    if (stop && queued == 0) return;
+  }
+}
+
+void ThreadPool::run(std::vector<Task> &tasks) {
+  if (tasks.empty()) return;
+  Group group{};
+  group.pending = tasks.size();
+  {
+    std::lock_guard<std::mutex> lk(sleepLock);
+    queued += tasks.size();
+  }
+  auto n = static_cast<unsigned>(queues.size());
+  auto first = next.fetch_add(1) % n;
+  for (std::size_t i = 0; i < tasks.size(); i++) {
+    auto &q = *queues[(first + i) % n];
+    std::lock_guard<std::mutex> lk(q.lock);
+    q.items.push_back(Item{std::move(tasks[i]), &group});
+  }
+  wake.notify_all();
+
+  //! help until nothing is left to take, what remains of this group is
+  //! already running on other threads
+  while (tryRun(first)) {
+  }
+  std::unique_lock<std::mutex> lk(group.lock);
+  group.done.wait(lk, [&group] { return group.pending == 0; });
+}
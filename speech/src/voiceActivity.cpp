@@ -0,0 +1,155 @@
+/*
+ * @file voiceActivity.cpp
+ * @brief energy and zero crossing voice activity detector, finds the frames
+ * worth running the f0 estimator on
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include "voiceActivity.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//! samples read at a time
+const int kChunk = 1 << 16;
+//! below it a frame is silence whatever the file, in dB of full scale
+const float kSilenceFloor = -60.0f;
+//! how far above the noise floor speech has to be at most, in dB
+const float kNoiseMargin = 12.0f;
+//! voiced speech crosses zero far less often than hiss
+const float kMaxCrossingRate = 3000.0f;
+//! shorter runs are clicks, in seconds
+const double kMinSpeech = 0.03;
+//! context kept around a run so soft onsets and decays are estimated
+const double kPadding = 0.15;
+//! runs closer than this are estimated as one region
+const double kMergeGap = 0.3;
+
+int toFrames(double seconds, const SpeechOptions &options) {
+  return static_cast<int>(std::ceil(seconds * 1000.0 / options.frame_period));
+}
+
+/*
+ * @brief level and zero crossing rate of every frame, over the two frame
+ * periods around the frame position. one pass, one chunk in memory.
+ */
+void measureFrames(const SpeechOptions &options, int fs, std::int64_t length,
+                   int numOfFrame, const SampleReader &read,
+                   VadScratch &scratch) {
+  double samplesPerFrame = fs * options.frame_period / 1000.0;
+  //! per period sums first, period k is [k, k + 1) frame periods
+  auto &energy = scratch.level;
+  auto &crossings = scratch.rate;
+  energy.assign(numOfFrame, 0.0f);
+  crossings.assign(numOfFrame, 0.0f);
+  scratch.x.resize(static_cast<std::size_t>(
+      std::min<std::int64_t>(kChunk, length)));
+
+  int period{};
+  double boundary = samplesPerFrame;
+  double sum{};
+  int count{};
+  double previous{};
+  for (std::int64_t start = 0; start < length; start += kChunk) {
+    int n = static_cast<int>(std::min<std::int64_t>(kChunk, length - start));
+    read(start, n, scratch.x.data());
+    for (int i = 0; i < n; i++) {
+      double v = scratch.x[i];
+      if (start + i >= boundary && period + 1 < numOfFrame) {
+        energy[period] = static_cast<float>(sum);
+        crossings[period] += count;
+        period++;
+        boundary = (period + 1) * samplesPerFrame;
+        sum = 0.0;
+        count = 0;
+      }
+      sum += v * v;
+      count += (v >= 0.0) != (previous >= 0.0);
+      previous = v;
+    }
+  }
+  energy[period] = static_cast<float>(sum);
+  crossings[period] += count;
+
+  //! frames from pairs of periods, in place from the end
+  for (int i = numOfFrame - 1; i >= 0; i--) {
+    double e = energy[i];
+    double c = crossings[i];
+    auto first =
+        static_cast<std::int64_t>(std::round((i - 1) * samplesPerFrame));
+    auto last =
+        static_cast<std::int64_t>(std::round((i + 1) * samplesPerFrame));
+    if (i > 0) {
+      e += energy[i - 1];
+      c += crossings[i - 1];
+    }
+    double samples = static_cast<double>(std::max<std::int64_t>(
+        std::min(last, length) - std::max<std::int64_t>(first, 0), 1));
+    energy[i] = static_cast<float>(10.0 * std::log10(e / samples + 1e-12));
+    crossings[i] = static_cast<float>(c * fs / samples);
+  }
+}
+
+/*
+ * @brief level above which a frame is loud enough for speech, between the
+ * noise floor and the loud frames of the file
+ */
+float speechThreshold(VadScratch &scratch) {
+  auto &sorted = scratch.sorted;
+  sorted.assign(scratch.level.begin(), scratch.level.end());
+  auto at = [&sorted](double q) {
+    auto nth = sorted.begin() + static_cast<long>(q * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+  };
+  float noise = at(0.1);
+  float loud = at(0.95);
+  //! a flat level is either all silence or all speech, the floor decides
+  if (loud - noise < 6.0f) return kSilenceFloor;
+  return std::max(kSilenceFloor,
+                  noise + std::min(kNoiseMargin, (loud - noise) / 2));
+}
+
+}  // namespace
+
+void detectSpeech(const SpeechOptions &options, int fs, std::int64_t length,
+                  const SampleReader &read, VadScratch &scratch) {
+  auto &regions = scratch.regions;
+  regions.clear();
+  int numOfFrame = getSamplesForF0(options, fs, length);
+  if (numOfFrame <= 0 || length <= 0) return;
+
+  measureFrames(options, fs, length, numOfFrame, read, scratch);
+  float threshold = speechThreshold(scratch);
+  int minSpeech = toFrames(kMinSpeech, options);
+  int padding = toFrames(kPadding, options);
+  int mergeGap = toFrames(kMergeGap, options);
+
+  for (int i = 0; i < numOfFrame;) {
+    auto speech = [&scratch, threshold](int j) {
+      return scratch.level[j] > threshold &&
+             scratch.rate[j] < kMaxCrossingRate;
+    };
+    if (!speech(i)) {
+      i++;
+      continue;
+    }
+    int first = i;
+    while (i < numOfFrame && speech(i)) i++;
+    if (i - first < minSpeech) continue;
+
+    int begin = std::max(first - padding, 0);
+    int end = std::min(i + padding, numOfFrame);
+    if (!regions.empty() &&
+        begin <= regions.back().first + regions.back().count + mergeGap) {
+      regions.back().count = end - regions.back().first;
+    } else {
+      regions.push_back(FrameRange{begin, end - begin});
+    }
+  }
+}
@@ -0,0 +1,28 @@
+/*
+ * @file check.hpp
+ * @brief the one assertion the regression tests share, kept active in
+ * release builds unlike assert
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <cstdio>
+
+//! failed checks so far, main returns it so ctest sees the failure
+static int failures = 0;
+
+#define CHECK(condition)                                              \
+  do {                                                                \
+    if (!(condition)) {                                               \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+                  #condition);                                        \
+      failures++;                                                     \
+    }                                                                 \
+  } while (0)
+
+#endif  // CHECK_HPP
@@ -0,0 +1,123 @@
+/*
+ * @file pcmEncoderTest.cpp
+ * @brief the encoders of GetPcmEncoders against the scalar reference over
+ * every tail length, with nan, infinities and samples outside [-1, 1]
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "check.hpp"
+#include "pcmconvert.h"
+
+namespace {
+
+const int kLongest = 67;
+//! written past the end of the output, a kernel must leave it alone
+const unsigned char kGuard = 0xA5;
+
+std::vector<double> samples() {
+  const double inf = std::numeric_limits<double>::infinity();
+  const double special[] = {std::nan(""), inf, -inf, 1.0, -1.0,
+                            1.0000001, -1.0000001, 1e300, -1e300, 1e-300,
+                            -1e-300, 0.0, -0.0, 0.5, -0.5, 0.99999};
+  std::vector<double> out(special, special + sizeof special / sizeof *special);
+  for (int i = 0; out.size() < static_cast<std::size_t>(kLongest); i++) {
+    out.push_back(std::sin(i * 0.7) * 1.3);
+  }
+  return out;
+}
+
+using Encoder = void (*)(const double *, int, unsigned char *);
+
+std::vector<unsigned char> encode(Encoder encoder, const double *src, int n,
+                                  int width) {
+  std::vector<unsigned char> out(n * width + 16, kGuard);
+  encoder(src, n, out.data());
+  return out;
+}
+
+//! every length and start so each sample lands in a vector lane and a tail
+void integer(Encoder fast, Encoder scalar, int width) {
+  std::vector<double> x = samples();
+  for (int start = 0; start < 8; start++) {
+    for (int n = 0; start + n <= kLongest; n++) {
+      auto a = encode(fast, x.data() + start, n, width);
+      auto b = encode(scalar, x.data() + start, n, width);
+      CHECK(a == b);
+      for (std::size_t i = n * width; i < a.size(); i++) {
+        CHECK(a[i] == kGuard);
+      }
+    }
+  }
+}
+
+float floatAt(const std::vector<unsigned char> &bytes, int i) {
+  float v;
+  std::memcpy(&v, bytes.data() + 4 * i, 4);
+  return v;
+}
+
+//! compared as floats, the bits of a nan are not part of the contract
+void real(Encoder fast, Encoder scalar) {
+  std::vector<double> x = samples();
+  for (int start = 0; start < 8; start++) {
+    for (int n = 0; start + n <= kLongest; n++) {
+      auto a = encode(fast, x.data() + start, n, 4);
+      auto b = encode(scalar, x.data() + start, n, 4);
+      for (int i = 0; i < n; i++) {
+        float u = floatAt(a, i);
+        float v = floatAt(b, i);
+        CHECK(u == v || (std::isnan(u) && std::isnan(v)));
+      }
+      for (std::size_t i = 4 * n; i < a.size(); i++) {
+        CHECK(a[i] == kGuard);
+      }
+    }
+  }
+}
+
+int decoded(const std::vector<unsigned char> &bytes, int i, int width) {
+  unsigned u = 0;
+  for (int b = 0; b < width; b++) u |= bytes[width * i + b] << (8 * b);
+  int shift = 32 - 8 * width;
+  return static_cast<int>(u << shift) >> shift;
+}
+
+//! the scalar reference itself, truncated, saturated and nan at the bottom
+void reference() {
+  const PcmEncoders *scalar = GetScalarPcmEncoders();
+  const double x[] = {1.0, -1.0, 2.0, -2.0, std::nan(""), 0.99999, -0.99999,
+                      0.0};
+  const int s16[] = {32767, -32767, 32767, -32768, -32768, 32766, -32766, 0};
+  const int s24[] = {8388607, -8388607, 8388607, -8388608, -8388608,
+                     8388523, -8388523, 0};
+  const int n = sizeof x / sizeof *x;
+  auto a = encode(scalar->s16, x, n, 2);
+  auto b = encode(scalar->s24, x, n, 3);
+  for (int i = 0; i < n; i++) {
+    CHECK(decoded(a, i, 2) == s16[i]);
+    CHECK(decoded(b, i, 3) == s24[i]);
+  }
+}
+
+}  // namespace
+
+int main() {
+  const PcmEncoders *fast = GetPcmEncoders();
+  const PcmEncoders *scalar = GetScalarPcmEncoders();
+  std::printf("encoders: %s\n", fast->name);
+  integer(fast->s16, scalar->s16, 2);
+  integer(fast->s24, scalar->s24, 3);
+  real(fast->f32, scalar->f32);
+  reference();
+  if (failures) std::printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * @file pcmKernelTest.cpp
+ * @brief the decode kernels of GetPcmKernels against the scalar reference
+ * for every format, start offset and tail length, with the extreme codes of
+ * each width and nan and infinities in the float formats
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "check.hpp"
+#include "pcmconvert.h"
+
+namespace {
+
+const int kLongest = 67;
+//! written past the end of the output, a kernel must leave it alone
+const double kGuard = -12345.0;
+
+using Kernel = void (*)(const unsigned char *, int, double *);
+
+void putFloat(std::vector<unsigned char> &out, std::size_t at, float v) {
+  std::memcpy(out.data() + at, &v, 4);
+}
+
+void putDouble(std::vector<unsigned char> &out, std::size_t at, double v) {
+  std::memcpy(out.data() + at, &v, 8);
+}
+
+//! pseudo random bytes with the extremes of the format in the first samples
+std::vector<unsigned char> source(const char *format, int width, int length) {
+  std::vector<unsigned char> out(length * width);
+  std::uint32_t seed = 2021;
+  for (auto &b : out) {
+    seed = seed * 1664525u + 1013904223u;
+    b = static_cast<unsigned char>(seed >> 24);
+  }
+  const float fi = std::numeric_limits<float>::infinity();
+  const double di = std::numeric_limits<double>::infinity();
+  if (std::strcmp(format, "f32") == 0) {
+    const float special[] = {std::nanf(""), fi, -fi,
+                             std::numeric_limits<float>::max(),
+                             std::numeric_limits<float>::denorm_min(),
+                             -0.0f, 1.0f, -1.0f};
+    for (int i = 0; i < 8; i++) putFloat(out, 4 * i, special[i]);
+  } else if (std::strcmp(format, "f64") == 0) {
+    const double special[] = {std::nan(""), di, -di,
+                              std::numeric_limits<double>::max(),
+                              std::numeric_limits<double>::denorm_min(),
+                              -0.0, 1.0, -1.0};
+    for (int i = 0; i < 8; i++) putDouble(out, 8 * i, special[i]);
+  } else {
+    //! the most negative code, the most positive one, zero and -1
+    for (int b = 0; b < width; b++) {
+      out[b] = 0;
+      out[width + b] = 0xFF;
+      out[2 * width + b] = 0;
+      out[3 * width + b] = 0xFF;
+    }
+    out[width - 1] = 0x80;
+    out[2 * width - 1] = 0x7F;
+    if (width == 1) {
+      out[0] = 0x00;
+      out[1] = 0xFF;
+      out[2] = 0x80;
+      out[3] = 0x7F;
+    }
+  }
+  return out;
+}
+
+std::vector<double> decode(Kernel kernel, const unsigned char *src, int n) {
+  std::vector<double> out(n + 8, kGuard);
+  kernel(src, n, out.data());
+  return out;
+}
+
+bool same(double a, double b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+//! every length and start so each sample lands in a vector lane and a tail
+void compare(const char *format, Kernel fast, Kernel scalar, int width) {
+  std::vector<unsigned char> x = source(format, width, kLongest);
+  for (int start = 0; start < 8; start++) {
+    for (int n = 0; start + n <= kLongest; n++) {
+      const unsigned char *src = x.data() + start * width;
+      auto a = decode(fast, src, n);
+      auto b = decode(scalar, src, n);
+      bool equal = true;
+      for (int i = 0; i < n; i++) equal = equal && same(a[i], b[i]);
+      if (!equal) std::printf("%s start %d length %d\n", format, start, n);
+      CHECK(equal);
+      for (std::size_t i = n; i < a.size(); i++) CHECK(a[i] == kGuard);
+    }
+  }
+}
+
+//! the 8 bit formats decode every one of their 256 codes the same way
+void everyCode(const char *format, Kernel fast, Kernel scalar) {
+  unsigned char codes[256 + 8];
+  for (int i = 0; i < 256 + 8; i++) codes[i] = static_cast<unsigned char>(i);
+  for (int start = 0; start < 8; start++) {
+    auto a = decode(fast, codes + start, 256);
+    auto b = decode(scalar, codes + start, 256);
+    bool equal = true;
+    for (int i = 0; i < 256; i++) equal = equal && a[i] == b[i];
+    if (!equal) std::printf("%s every code, start %d\n", format, start);
+    CHECK(equal);
+  }
+}
+
+//! the scalar reference itself, the most negative code is exactly -1
+void reference() {
+  const PcmKernels *scalar = GetScalarPcmKernels();
+  double x[1];
+  const unsigned char u8[] = {0x00};
+  scalar->u8(u8, 1, x);
+  CHECK(x[0] == -1.0);
+  const unsigned char s16[] = {0x00, 0x80};
+  scalar->s16(s16, 1, x);
+  CHECK(x[0] == -1.0);
+  const unsigned char s24[] = {0x00, 0x00, 0x80};
+  scalar->s24(s24, 1, x);
+  CHECK(x[0] == -1.0);
+  const unsigned char s32[] = {0x00, 0x00, 0x00, 0x80};
+  scalar->s32(s32, 1, x);
+  CHECK(x[0] == -1.0);
+  const unsigned char top24[] = {0xFF, 0xFF, 0x7F};
+  scalar->s24(top24, 1, x);
+  CHECK(x[0] == 8388607.0 / 8388608.0);
+  //! g.711 silence, 0xD5 in a-law and 0xFF in mu-law
+  const unsigned char alaw[] = {0xD5};
+  scalar->alaw(alaw, 1, x);
+  CHECK(x[0] == 8.0 / 32768.0);
+  const unsigned char mulaw[] = {0xFF};
+  scalar->mulaw(mulaw, 1, x);
+  CHECK(x[0] == 0.0);
+}
+
+}  // namespace
+
+int main() {
+  const PcmKernels *fast = GetPcmKernels();
+  const PcmKernels *scalar = GetScalarPcmKernels();
+  std::printf("kernels: %s\n", fast->name);
+  compare("u8", fast->u8, scalar->u8, 1);
+  compare("s16", fast->s16, scalar->s16, 2);
+  compare("s24", fast->s24, scalar->s24, 3);
+  compare("s32", fast->s32, scalar->s32, 4);
+  compare("f32", fast->f32, scalar->f32, 4);
+  compare("f64", fast->f64, scalar->f64, 8);
+  compare("alaw", fast->alaw, scalar->alaw, 1);
+  compare("mulaw", fast->mulaw, scalar->mulaw, 1);
+  everyCode("u8", fast->u8, scalar->u8);
+  everyCode("alaw", fast->alaw, scalar->alaw);
+  everyCode("mulaw", fast->mulaw, scalar->mulaw);
+  reference();
+  if (failures) std::printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * @file voicedStatsTest.cpp
+ * @brief the median and percentiles of VoicedAccumulator, selected with
+ * nth_element, against a full sort of the voiced frames
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "check.hpp"
+#include "pitchStats.hpp"
+
+namespace {
+
+const unsigned kFlags = SpeechStatMedian | SpeechStatPercentiles;
+
+//! unsorted, repeated and outside [0, 100] on purpose
+const double kAsked[SPEECH_PERCENTILES_MAX] = {90.0, 10.0, 50.0, 0.0,
+                                               100.0, 25.5, 10.0, 120.0};
+
+//! linear interpolation between the closest ranks of the sorted values
+double reference(std::vector<double> sorted, double p) {
+  if (sorted.empty()) return std::nan("");
+  std::sort(sorted.begin(), sorted.end());
+  double rank = std::min(std::max(p, 0.0), 100.0) / 100.0 *
+                (sorted.size() - 1);
+  std::size_t low = static_cast<std::size_t>(rank);
+  double high = low + 1 < sorted.size() ? sorted[low + 1] : sorted[low];
+  return sorted[low] + (rank - std::floor(rank)) * (high - sorted[low]);
+}
+
+bool same(double a, double b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+//! pushes track in pieces of step frames and compares every statistic
+void compare(const std::vector<double> &track, int step) {
+  std::vector<double> voiced;
+  for (double v : track) {
+    if (v > 0.0) voiced.push_back(v);
+  }
+  std::vector<double> values;
+  VoicedAccumulator acc(kFlags, values);
+  for (std::size_t i = 0; i < track.size(); i += step) {
+    int count = static_cast<int>(
+        std::min<std::size_t>(step, track.size() - i));
+    acc.push(track.data() + i, count);
+  }
+  VoicedStats stats = acc.finish(kAsked, SPEECH_PERCENTILES_MAX);
+  CHECK(stats.frames == static_cast<int>(track.size()));
+  CHECK(stats.voiced == static_cast<int>(voiced.size()));
+  CHECK(stats.percentileCount == SPEECH_PERCENTILES_MAX);
+  CHECK(same(stats.median, reference(voiced, 50.0)));
+  for (int i = 0; i < SPEECH_PERCENTILES_MAX; i++) {
+    CHECK(same(stats.percentile[i], reference(voiced, kAsked[i])));
+  }
+}
+
+//! a few distinct pitches so most values repeat, with unvoiced gaps
+std::vector<double> track(std::uint32_t &seed, int length) {
+  std::vector<double> out(length);
+  for (auto &v : out) {
+    seed = seed * 1664525u + 1013904223u;
+    unsigned r = seed >> 24;
+    v = r < 64 ? 0.0 : 80.0 + 5.0 * (r % 23) + 0.25 * (r % 3);
+  }
+  return out;
+}
+
+void small() {
+  compare({}, 1);
+  compare({0.0, 0.0, -1.0, std::nan("")}, 2);
+  compare({120.0}, 1);
+  compare({0.0, 150.0, 0.0, 110.0}, 3);
+  compare({200.0, 200.0, 200.0}, 1);
+}
+
+void generated() {
+  std::uint32_t seed = 12345;
+  for (int length = 1; length <= 300; length += 7) {
+    std::vector<double> f0 = track(seed, length);
+    compare(f0, length);
+    compare(f0, 1 + length % 13);
+  }
+}
+
+//! fewer percentiles than asked for, and more than fit
+void counts() {
+  std::uint32_t seed = 99;
+  std::vector<double> f0 = track(seed, 50);
+  std::vector<double> values;
+  VoicedAccumulator one(SpeechStatPercentiles, values);
+  one.push(f0.data(), 50);
+  VoicedStats stats = one.finish(kAsked + 5, 1);
+  CHECK(stats.percentileCount == 1);
+  CHECK(stats.median == 0.0);
+
+  std::vector<double> voiced;
+  for (double v : f0) {
+    if (v > 0.0) voiced.push_back(v);
+  }
+  CHECK(same(stats.percentile[0], reference(voiced, kAsked[5])));
+
+  VoicedAccumulator many(kFlags, values);
+  many.push(f0.data(), 50);
+  stats = many.finish(kAsked, SPEECH_PERCENTILES_MAX + 3);
+  CHECK(stats.percentileCount == SPEECH_PERCENTILES_MAX);
+}
+
+}  // namespace
+
+int main() {
+  small();
+  generated();
+  counts();
+  if (failures) std::printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
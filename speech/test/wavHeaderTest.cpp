@@ -0,0 +1,234 @@
+/*
+ * @file wavHeaderTest.cpp
+ * @brief the riff chunk walk of wavparse and wavprobe: chunk order, odd
+ * sizes padded to even, metadata that looks like data and rf64 sizes taken
+ * from the ds64 chunk
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "audioio.h"
+#include "check.hpp"
+
+namespace {
+
+using Bytes = std::vector<unsigned char>;
+
+const std::int16_t kSamples[] = {0, 16384, -16384, 32767, -32768, 1};
+const int kCount = 6;
+const int kFs = 16000;
+
+void putU16(Bytes &out, std::uint32_t v) {
+  out.push_back(static_cast<unsigned char>(v));
+  out.push_back(static_cast<unsigned char>(v >> 8));
+}
+
+void putU32(Bytes &out, std::uint32_t v) {
+  putU16(out, v & 0xFFFF);
+  putU16(out, v >> 16);
+}
+
+void putU64(Bytes &out, std::uint64_t v) {
+  putU32(out, static_cast<std::uint32_t>(v));
+  putU32(out, static_cast<std::uint32_t>(v >> 32));
+}
+
+void putTag(Bytes &out, const char *tag) {
+  out.insert(out.end(), tag, tag + 4);
+}
+
+//! a chunk with the given declared size, padded to even like riff wants
+void putChunk(Bytes &out, const char *tag, const Bytes &body,
+              std::uint32_t size) {
+  putTag(out, tag);
+  putU32(out, size);
+  out.insert(out.end(), body.begin(), body.end());
+  if (body.size() & 1) out.push_back(0);
+}
+
+void putChunk(Bytes &out, const char *tag, const Bytes &body) {
+  putChunk(out, tag, body, static_cast<std::uint32_t>(body.size()));
+}
+
+Bytes fmtBody(int channels, int nbit) {
+  Bytes body;
+  putU16(body, 1);
+  putU16(body, channels);
+  putU32(body, kFs);
+  putU32(body, kFs * channels * nbit / 8);
+  putU16(body, channels * nbit / 8);
+  putU16(body, nbit);
+  return body;
+}
+
+Bytes dataBody() {
+  Bytes body;
+  for (auto v : kSamples) putU16(body, static_cast<std::uint16_t>(v));
+  return body;
+}
+
+//! "RIFF" or "RF64", the size and "WAVE" in front of the chunks
+Bytes riff(const char *form, const Bytes &chunks) {
+  Bytes out;
+  putTag(out, form);
+  putU32(out, std::string(form) == "RIFF"
+                  ? static_cast<std::uint32_t>(4 + chunks.size())
+                  : 0xFFFFFFFF);
+  putTag(out, "WAVE");
+  out.insert(out.end(), chunks.begin(), chunks.end());
+  return out;
+}
+
+//! parses as 16 bit mono kSamples with the payload at offset
+void checkParsed(const Bytes &file, std::size_t offset, int length = kCount) {
+  WavFile wav{};
+  CHECK(wavparse(file.data(), file.size(), &wav) == 1);
+  CHECK(wav.fs == kFs);
+  CHECK(wav.nbit == 16);
+  CHECK(wav.format == 1);
+  CHECK(wav.channels == 1);
+  CHECK(wav.length == length);
+  CHECK(wav.data == file.data() + offset);
+  if (wav.length != length || wav.data != file.data() + offset) return;
+  std::vector<double> x(length);
+  wavdecode(&wav, x.data());
+  for (int i = 0; i < length; i++) CHECK(x[i] == kSamples[i] / 32768.0);
+}
+
+void plain() {
+  Bytes chunks;
+  putChunk(chunks, "fmt ", fmtBody(1, 16));
+  putChunk(chunks, "data", dataBody());
+  checkParsed(riff("RIFF", chunks), 12 + 24 + 8);
+}
+
+//! data before fmt, behind an odd sized LIST holding the text "data"
+void reordered() {
+  Bytes list;
+  putTag(list, "INFO");
+  putTag(list, "data");
+  putU32(list, 2);
+  list.push_back('x');
+  Bytes chunks;
+  putChunk(chunks, "LIST", list);
+  std::size_t offset = 12 + chunks.size() + 8;
+  putChunk(chunks, "data", dataBody());
+  putChunk(chunks, "fmt ", fmtBody(1, 16));
+  CHECK(list.size() == 13);
+  checkParsed(riff("RIFF", chunks), offset);
+}
+
+//! odd chunks are followed by a pad byte that belongs to no chunk
+void padding() {
+  Bytes chunks;
+  putChunk(chunks, "junk", Bytes{1, 2, 3});
+  putChunk(chunks, "fmt ", fmtBody(1, 16));
+  putChunk(chunks, "bext", Bytes{'d', 'a', 't', 'a', 0});
+  std::size_t offset = 12 + chunks.size() + 8;
+  putChunk(chunks, "data", dataBody());
+  checkParsed(riff("RIFF", chunks), offset);
+}
+
+//! a recording cut short declares more data than it holds
+void truncated() {
+  Bytes chunks;
+  putChunk(chunks, "fmt ", fmtBody(1, 16));
+  putChunk(chunks, "data", dataBody(), 1000);
+  checkParsed(riff("RIFF", chunks), 12 + 24 + 8);
+}
+
+Bytes rf64File() {
+  Bytes ds64;
+  putU64(ds64, 0);
+  putU64(ds64, 2 * kCount);
+  putU64(ds64, kCount);
+  putU32(ds64, 0);
+  Bytes chunks;
+  putChunk(chunks, "ds64", ds64);
+  putChunk(chunks, "fmt ", fmtBody(1, 16));
+  //! a 32 bit data size of all ones is the one of the ds64 chunk
+  putChunk(chunks, "data", dataBody(), 0xFFFFFFFF);
+  return riff("RF64", chunks);
+}
+
+void rf64() { checkParsed(rf64File(), 12 + 36 + 24 + 8); }
+
+void rejected() {
+  WavFile wav{};
+  Bytes noData;
+  putChunk(noData, "fmt ", fmtBody(1, 16));
+  CHECK(wavparse(riff("RIFF", noData).data(), 12 + noData.size(), &wav) ==
+        -1);
+
+  Bytes noFormat;
+  putChunk(noFormat, "data", dataBody());
+  CHECK(wavparse(riff("RIFF", noFormat).data(), 12 + noFormat.size(),
+                 &wav) == -1);
+
+  Bytes badAlign = fmtBody(1, 16);
+  badAlign[12] = 4;
+  Bytes chunks;
+  putChunk(chunks, "fmt ", badAlign);
+  putChunk(chunks, "data", dataBody());
+  CHECK(wavparse(riff("RIFF", chunks).data(), 12 + chunks.size(), &wav) ==
+        -1);
+
+  Bytes notWave = riff("RIFF", chunks);
+  notWave[8] = 'X';
+  CHECK(wavparse(notWave.data(), notWave.size(), &wav) == -1);
+
+  //! a rate of 0 or one that does not fit an int is the file's fault
+  for (std::uint32_t fs : {0u, 0x80000000u, 0xFFFFFFFFu}) {
+    Bytes rate = fmtBody(1, 16);
+    rate[4] = static_cast<unsigned char>(fs);
+    rate[5] = static_cast<unsigned char>(fs >> 8);
+    rate[6] = static_cast<unsigned char>(fs >> 16);
+    rate[7] = static_cast<unsigned char>(fs >> 24);
+    Bytes bad;
+    putChunk(bad, "fmt ", rate);
+    putChunk(bad, "data", dataBody());
+    CHECK(wavparse(riff("RIFF", bad).data(), 12 + bad.size(), &wav) == -1);
+  }
+}
+
+//! wavprobe walks the same chunks through positioned reads of a file
+void probe() {
+  const char *name = "wavHeaderTest.wav";
+  Bytes file = rf64File();
+  std::FILE *f = std::fopen(name, "wb");
+  CHECK(f != NULL);
+  if (!f) return;
+  std::fwrite(file.data(), 1, file.size(), f);
+  std::fclose(f);
+
+  WavInfo info{};
+  CHECK(wavprobe(name, &info) == 1);
+  CHECK(info.fs == kFs);
+  CHECK(info.nbit == 16);
+  CHECK(info.channels == 1);
+  CHECK(info.frames == kCount);
+  CHECK(info.data_offset == 12 + 36 + 24 + 8);
+  CHECK(info.data_size == 2 * kCount);
+  std::remove(name);
+}
+
+}  // namespace
+
+int main() {
+  plain();
+  reordered();
+  padding();
+  truncated();
+  rf64();
+  rejected();
+  probe();
+  if (failures) std::printf("%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
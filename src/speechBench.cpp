@@ -0,0 +1,357 @@
+/*
+ * @file speechBench.cpp
+ * @brief throughput benchmarks of the speech library
+ *
+ * the output follows the google benchmark json format so the usual compare
+ * tools can diff two runs, e.g. before and after bumping the world submodule.
+ * options:
+ *   --benchmark_filter=<regex>     run only the matching benchmarks
+ *   --benchmark_min_time=<seconds> minimum measuring time per benchmark
+ *   --benchmark_out=<file>         write the json there instead of stdout
+ *   --data_dir=<dir>               location of the bundled wav files
+ *
+Authored by Suka Isnaini on 9th of August 2021
+Created for PT Sejahtera Empati Pratama
+All Copyrights belong to PT Sejahtera Empati Pratama
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audioio.h"
+#include "nlohmann/json.hpp"
+#include "pitchStats.hpp"
+#include "speech.hpp"
+#include "world/dio.h"
+#include "world/harvest.h"
+#include "world/stonemask.h"
+
+#ifndef SPEECH_BENCH_DATA
+#define SPEECH_BENCH_DATA "."
+#endif
+
+#if defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+/*
+ * @brief every allocation of the process goes through these, the library
+ * included since it is linked statically
+ */
+static std::atomic<std::uint64_t> allocations{};
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+//! kept out of line, inlined into a delete expression gcc sees free given a
+//! pointer from operator new and warns (-Wmismatched-new-delete)
+BENCH_NOINLINE void operator delete(void *p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete[](void *p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+BENCH_NOINLINE void operator delete[](void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+/*
+ * @brief one benchmark, body runs `iterations` times and returns the number
+ * of items (samples or frames) processed per iteration
+ */
+struct Benchmark {
+  std::string name;
+  std::function<std::int64_t()> body;
+};
+
+/*
+ * @brief voiced sawtooth like signal with a slow vibrato and a little noise,
+ * with a silent gap in the middle so the estimators see unvoiced frames too
+ */
+std::vector<double> syntheticSignal(int fs, double seconds) {
+  std::vector<double> x(static_cast<std::size_t>(fs * seconds));
+  std::uint32_t seed = 12345;
+  double phase{};
+  for (std::size_t i = 0; i < x.size(); i++) {
+    double t = static_cast<double>(i) / fs;
+    double f0 = 140.0 + 30.0 * std::sin(2.0 * kPi * 0.7 * t);
+    phase += 2.0 * kPi * f0 / fs;
+    double voiced{};
+    for (int h = 1; h <= 8; h++) voiced += std::sin(h * phase) / h;
+    seed = seed * 1664525u + 1013904223u;
+    double noise = (seed >> 8) / 16777216.0 - 0.5;
+    bool gap = std::fmod(t, 2.0) > 1.6;
+    x[i] = (gap ? 0.0 : 0.25 * voiced) + 0.01 * noise;
+  }
+  return x;
+}
+
+/*
+ * @brief f0 track with the same voiced/unvoiced pattern as the signal
+ */
+std::vector<double> syntheticTrack(int frames) {
+  std::vector<double> f0(frames);
+  for (int i = 0; i < frames; i++) {
+    f0[i] = i % 400 < 320 ? 140.0 + 30.0 * std::sin(i * 0.02) : 0.0;
+  }
+  return f0;
+}
+
+struct Result {
+  std::int64_t iterations{};
+  double realNs{};
+  double cpuNs{};
+  double items{};
+  double allocs{};
+};
+
+double cpuNow() { return static_cast<double>(std::clock()) / CLOCKS_PER_SEC; }
+
+/*
+ * @brief run the body with a growing iteration count until one batch lasts
+ * at least minTime, like google benchmark does
+ */
+Result measure(const Benchmark &bench, double minTime) {
+  bench.body();  //! warm up, fills caches and lazy statics
+  Result r{};
+  for (std::int64_t n = 1;; n *= 4) {
+    std::int64_t items{};
+    auto allocBefore = allocations.load();
+    double cpuStart = cpuNow();
+    auto start = std::chrono::steady_clock::now();
+    for (std::int64_t i = 0; i < n; i++) items += bench.body();
+    double real = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    double cpu = cpuNow() - cpuStart;
+    if (real >= minTime || n >= (std::int64_t(1) << 30)) {
+      r.iterations = n;
+      r.realNs = real * 1e9 / n;
+      r.cpuNs = cpu * 1e9 / n;
+      r.items = static_cast<double>(items) / real;
+      r.allocs = static_cast<double>(allocations.load() - allocBefore) / n;
+      return r;
+    }
+  }
+}
+
+std::string fileLabel(const std::string &path) {
+  return std::filesystem::path(path).filename().string();
+}
+
+/*
+ * @brief the benchmark list. synthetic wav files are written to the temp
+ * directory so the file based entry points see the same signals.
+ */
+std::vector<Benchmark> registerBenchmarks(const std::string &dataDir,
+                                          std::vector<std::string> &temps) {
+  std::vector<Benchmark> list;
+
+  std::vector<std::string> files;
+  for (const char *name : {"test.wav", "lagu.wav", "ID0001_channel1.wav"}) {
+    auto path = (std::filesystem::path(dataDir) / name).string();
+    if (std::filesystem::exists(path)) files.push_back(path);
+  }
+  for (int fs : {16000, 44100}) {
+    for (double seconds : {1.0, 10.0}) {
+      auto x = syntheticSignal(fs, seconds);
+      std::ostringstream name;
+      name << "speech_bench_" << fs << "_" << seconds << "s.wav";
+      auto path =
+          (std::filesystem::temp_directory_path() / name.str()).string();
+      wavwrite(x.data(), static_cast<int>(x.size()), fs, 16, path.c_str());
+      temps.push_back(path);
+      files.push_back(path);
+    }
+  }
+
+  for (const auto &file : files) {
+    list.push_back({"BM_GetAudioLength/" + fileLabel(file), [file] {
+                      GetAudioLength(file.c_str());
+                      return std::int64_t(1);
+                    }});
+    list.push_back({"BM_wavread/" + fileLabel(file), [file] {
+                      int length = GetAudioLength(file.c_str());
+                      std::vector<double> x(length > 0 ? length : 0);
+                      int fs, nbit;
+                      if (length > 0) {
+                        wavread(file.c_str(), &fs, &nbit, x.data());
+                      }
+                      return std::int64_t(x.size());
+                    }});
+    std::int64_t samples = GetAudioLength(file.c_str());
+    list.push_back({"BM_PitchAnalyzer2/" + fileLabel(file), [file, samples] {
+                      delete[] PitchAnalyzer2(file.c_str());
+                      return samples;
+                    }});
+    //! the cpu time saved per recording by decimating ahead of the estimator
+    for (int rate : {0, 16000, 8000}) {
+      std::shared_ptr<SpeechContext> ctx(SpeechCreate(), SpeechDestroy);
+      SpeechOptions options;
+      SpeechInitializeOptions(&options);
+      options.analysis_rate = rate;
+      SpeechSetOptions(ctx.get(), &options);
+      list.push_back({"BM_SpeechAnalyze/" + fileLabel(file) +
+                          "/analysis_rate:" + std::to_string(rate),
+                      [file, samples, ctx] {
+                        SpeechAnalyze(ctx.get(), file.c_str());
+                        return samples;
+                      }});
+    }
+  }
+
+  for (int fs : {8000, 16000, 44100}) {
+    for (double seconds : {1.0, 5.0}) {
+      auto x =
+          std::make_shared<std::vector<double>>(syntheticSignal(fs, seconds));
+      std::ostringstream arg;
+      arg << "/fs:" << fs << "/seconds:" << seconds;
+      list.push_back({"BM_Harvest" + arg.str(), [x, fs] {
+                        HarvestOption option;
+                        InitializeHarvestOption(&option);
+                        int length = static_cast<int>(x->size());
+                        int frames = GetSamplesForHarvest(fs, length,
+                                                          option.frame_period);
+                        std::vector<double> tp(frames), f0(frames);
+                        Harvest(x->data(), length, fs, &option, tp.data(),
+                                f0.data());
+                        return std::int64_t(length);
+                      }});
+      list.push_back({"BM_Dio" + arg.str(), [x, fs] {
+                        DioOption option;
+                        InitializeDioOption(&option);
+                        int length = static_cast<int>(x->size());
+                        int frames =
+                            GetSamplesForDIO(fs, length, option.frame_period);
+                        std::vector<double> tp(frames), f0(frames);
+                        Dio(x->data(), length, fs, &option, tp.data(),
+                            f0.data());
+                        return std::int64_t(length);
+                      }});
+      list.push_back({"BM_DioStoneMask" + arg.str(), [x, fs] {
+                        DioOption option;
+                        InitializeDioOption(&option);
+                        int length = static_cast<int>(x->size());
+                        int frames =
+                            GetSamplesForDIO(fs, length, option.frame_period);
+                        std::vector<double> tp(frames), f0(frames),
+                            refined(frames);
+                        Dio(x->data(), length, fs, &option, tp.data(),
+                            f0.data());
+                        StoneMask(x->data(), length, fs, tp.data(), f0.data(),
+                                  frames, refined.data());
+                        return std::int64_t(length);
+                      }});
+    }
+  }
+
+  using PitchFn = double (*)(const double *, int);
+  const std::pair<const char *, PitchFn> pitch[] = {
+      {"BM_getPitch1", getPitch1},
+      {"BM_getPitch2", getPitch2},
+      {"BM_getPitch3", getPitch3},
+      {"BM_getPitch4", getPitch4}};
+  for (int frames : {1000, 100000}) {
+    auto f0 = std::make_shared<std::vector<double>>(syntheticTrack(frames));
+    for (const auto &p : pitch) {
+      auto fn = p.second;
+      list.push_back(
+          {std::string(p.first) + "/frames:" + std::to_string(frames),
+           [f0, fn, frames] {
+             volatile double sink = fn(f0->data(), frames);
+             (void)sink;
+             return std::int64_t(frames);
+           }});
+    }
+    list.push_back({"BM_computePitchStats/frames:" + std::to_string(frames),
+                    [f0, frames] {
+                      volatile double sink =
+                          computePitchStats(f0->data(), frames).pitch4();
+                      (void)sink;
+                      return std::int64_t(frames);
+                    }});
+  }
+  return list;
+}
+
+std::string argValue(const std::string &arg, const std::string &key) {
+  return arg.compare(0, key.size(), key) == 0 ? arg.substr(key.size()) : "";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string filter = ".*";
+  std::string out;
+  std::string dataDir = SPEECH_BENCH_DATA;
+  double minTime = 0.5;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    std::string v;
+    if (!(v = argValue(arg, "--benchmark_filter=")).empty()) filter = v;
+    if (!(v = argValue(arg, "--benchmark_min_time=")).empty()) {
+      minTime = std::atof(v.c_str());
+    }
+    if (!(v = argValue(arg, "--benchmark_out=")).empty()) out = v;
+    if (!(v = argValue(arg, "--data_dir=")).empty()) dataDir = v;
+  }
+
+  std::vector<std::string> temps;
+  auto list = registerBenchmarks(dataDir, temps);
+  std::regex match(filter);
+
+  nlohmann::json report;
+  auto now = std::time(nullptr);
+  char date[64];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  report["context"] = {{"date", date},
+                       {"executable", argv[0]},
+                       {"num_cpus", std::thread::hardware_concurrency()},
+                       {"library_build_type", "unknown"}};
+  auto &benchmarks = report["benchmarks"] = nlohmann::json::array();
+  for (const auto &bench : list) {
+    if (!std::regex_search(bench.name, match)) continue;
+    std::cerr << bench.name << "\n";
+    auto r = measure(bench, minTime);
+    benchmarks.push_back({{"name", bench.name},
+                          {"run_name", bench.name},
+                          {"run_type", "iteration"},
+                          {"iterations", r.iterations},
+                          {"real_time", r.realNs},
+                          {"cpu_time", r.cpuNs},
+                          {"time_unit", "ns"},
+                          {"items_per_second", r.items},
+                          {"allocs_per_iter", r.allocs}});
+  }
+  for (const auto &path : temps) std::filesystem::remove(path);
+
+  if (out.empty()) {
+    std::cout << report.dump(2) << "\n";
+  } else {
+    std::ofstream(out) << report.dump(2) << "\n";
+  }
+  return {};
+}